@@ -0,0 +1,113 @@
+#pragma once
+
+#include <QtGlobal>
+#include <algorithm>
+#include <mutex>
+
+/**
+ * AdmissionController - HTTP 请求的准入控制与过载卸载
+ * 作用：挡在 [Custom] / Google 处理函数之前，限制积压在服务内的请求数。
+ *       上游变慢时排队延迟不再无限增长，超出的请求立刻得到 503 + Retry-After，
+ *       而不是一直等到游戏端超时再重发，让过载雪上加霜。
+ * 判定：
+ *   - 积压数 (已准入、尚未应答) 达到 maxPending：拒绝
+ *   - 当前排队延迟超过 queueBudgetMs：拒绝。排队延迟由调用方给出 (上游限流队列队首已等待的时间)，
+ *     只反映上游跟不上的程度：译文记忆命中不进入该队列，突发流量在上游够快时也不会被误卸载
+ * 票据：准入成功返回 RAII 票据，处理函数返回时析构即释放积压名额。
+ */
+class AdmissionController {
+public:
+    enum class Verdict {
+        Admitted,
+        QueueFull,  // 积压数达到上限
+        OverBudget  // 排队延迟超出预算
+    };
+
+    struct Stats {
+        int pending = 0;
+        int peakPending = 0;
+        quint64 admitted = 0;
+        quint64 shedFull = 0;
+        quint64 shedBudget = 0;
+        qint64 queueDelayMs = 0; // 最近一次判定时的排队延迟
+        int maxPending = 0;
+        int queueBudgetMs = 0;
+    };
+
+    class Ticket {
+    public:
+        Ticket() = default;
+        Ticket(Ticket&& other) noexcept : m_owner(other.m_owner) { other.m_owner = nullptr; }
+        Ticket(const Ticket&) = delete;
+        Ticket& operator=(const Ticket&) = delete;
+        Ticket& operator=(Ticket&&) = delete;
+        ~Ticket() {
+            if (m_owner)
+                m_owner->release();
+        }
+
+        explicit operator bool() const { return m_owner != nullptr; }
+
+    private:
+        friend class AdmissionController;
+        AdmissionController* m_owner = nullptr;
+    };
+
+    // maxPending / queueBudgetMs 为 0 表示不做对应的限制
+    void configure(int maxPending, int queueBudgetMs) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_maxPending = std::max(0, maxPending);
+        m_budgetMs = std::max(0, queueBudgetMs);
+        m_stats.peakPending = m_pending;
+    }
+
+    // 尝试准入：queueDelayMs 为当前排队延迟；被拒绝时返回空票据，retryAfterSec 为建议客户端等待的秒数
+    Ticket admit(qint64 queueDelayMs, Verdict& verdict, int& retryAfterSec) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.queueDelayMs = queueDelayMs;
+        // 积压大致按当前排队延迟的速度消化：建议等这么久再来 (至少 1 秒)
+        retryAfterSec = static_cast<int>(std::clamp<qint64>((queueDelayMs + 999) / 1000, 1, MAX_RETRY_AFTER_SEC));
+
+        Ticket ticket;
+        if (m_maxPending > 0 && m_pending >= m_maxPending) {
+            verdict = Verdict::QueueFull;
+            m_stats.shedFull++;
+            return ticket;
+        }
+        if (m_budgetMs > 0 && queueDelayMs > m_budgetMs) {
+            verdict = Verdict::OverBudget;
+            m_stats.shedBudget++;
+            return ticket;
+        }
+
+        verdict = Verdict::Admitted;
+        ticket.m_owner = this;
+        m_pending++;
+        m_stats.admitted++;
+        m_stats.peakPending = std::max(m_stats.peakPending, m_pending);
+        return ticket;
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stats st = m_stats;
+        st.pending = m_pending;
+        st.maxPending = m_maxPending;
+        st.queueBudgetMs = m_budgetMs;
+        return st;
+    }
+
+private:
+    void release() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending--;
+    }
+
+    static constexpr qint64 MAX_RETRY_AFTER_SEC = 30;
+
+    int m_maxPending = 512;
+    int m_budgetMs = 20000;
+    int m_pending = 0;
+    Stats m_stats;
+    mutable std::mutex m_mutex;
+};
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/**
+ * ApiKeyScheduler - 按健康度与速率限制调度多个 API Key
+ * 作用：取代简单轮询。每个 Key 有独立的 RPM / TPM 令牌桶，
+ *       429 按 Retry-After (缺省指数退避) 冷却，401/403 隔离一段时间，
+ *       在可用的 Key 中选择当前在途最少 (同负载时剩余配额最多) 的一个。
+ * 配置：Key 列表仍为逗号分隔；单个 Key 可写成 "sk-xxx@RPM/TPM" 覆盖全局默认限额 (0 为不限)，
+ *       便于混用不同档位的 Key。
+ */
+class ApiKeyScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Lease {
+        int index = -1;
+        QString key;
+        int reservedTokens = 0;
+        bool valid() const { return index >= 0; }
+    };
+
+    struct KeyStats {
+        QString label;      // 脱敏后的 Key
+        int inFlight = 0;
+        quint64 requests = 0;
+        quint64 errors = 0;
+        quint64 throttled = 0;
+        quint64 tokens = 0;
+        int rpmLimit = 0;
+        int tpmLimit = 0;
+        qint64 cooldownMs = 0;
+        bool quarantined = false;
+    };
+
+    void setKeys(const QStringList& specs, int defaultRpm, int defaultTpm) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<KeyState> next;
+        for (const QString& raw : specs) {
+            KeyState st;
+            st.rpm = std::max(0, defaultRpm);
+            st.tpm = std::max(0, defaultTpm);
+            st.key = parseSpec(raw, st.rpm, st.tpm);
+            if (st.key.isEmpty() || std::any_of(next.begin(), next.end(), [&st](const KeyState& k) { return k.key == st.key; }))
+                continue;
+            st.rpmTokens = st.rpm;
+            st.tpmTokens = st.tpm;
+            // 同一个 Key 重新加载配置时保留统计、健康状态与剩余配额
+            for (const KeyState& old : m_keys) {
+                if (old.key == st.key) {
+                    const int rpm = st.rpm, tpm = st.tpm;
+                    st = old;
+                    st.rpm = rpm;
+                    st.tpm = tpm;
+                    st.rpmTokens = std::min<double>(st.rpmTokens, rpm);
+                    st.tpmTokens = std::min<double>(st.tpmTokens, tpm);
+                    break;
+                }
+            }
+            st.lastRefill = Clock::now();
+            next.push_back(st);
+        }
+        m_keys.swap(next);
+        m_cv.notify_all();
+    }
+
+    bool hasKeys() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return !m_keys.empty();
+    }
+
+    bool contains(const QString& key) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return std::any_of(m_keys.begin(), m_keys.end(), [&key](const KeyState& k) { return k.key == key; });
+    }
+
+    // 解析 "sk-xxx@RPM/TPM"：返回 Key 本体；带 @ 后缀时覆盖传入的 rpm / tpm
+    static QString parseSpec(const QString& raw, int& rpm, int& tpm) {
+        QString spec = raw.trimmed();
+        const qsizetype at = spec.lastIndexOf('@');
+        if (at > 0) {
+            const QStringList limits = spec.mid(at + 1).split('/');
+            bool ok = false;
+            const int r = limits.value(0).toInt(&ok);
+            if (ok) {
+                rpm = std::max(0, r);
+                tpm = limits.size() > 1 ? std::max(0, limits[1].toInt()) : tpm;
+                spec = spec.left(at).trimmed();
+            }
+        }
+        return spec;
+    }
+
+    // 选出一个可用 Key；全部不可用时最多等待 maxWait，仍不可用返回无效 Lease
+    // shouldAbort 可能探测客户端连接 (系统调用)，只在锁外调用
+    Lease acquire(int estimatedTokens, std::chrono::milliseconds maxWait, const std::function<bool()>& shouldAbort) {
+        const auto giveUp = Clock::now() + maxWait;
+        if (shouldAbort && shouldAbort())
+            return Lease();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            if (m_keys.empty())
+                return Lease();
+            const auto now = Clock::now();
+            refill(now);
+            int best = -1;
+            for (int i = 0; i < static_cast<int>(m_keys.size()); ++i) {
+                if (!available(m_keys[i], now, estimatedTokens))
+                    continue;
+                if (best < 0 || better(m_keys[i], m_keys[best]))
+                    best = i;
+            }
+            if (best >= 0)
+                return take(best, estimatedTokens);
+            if (now >= giveUp)
+                return Lease();
+            m_cv.wait_until(lock, std::min(giveUp, now + std::chrono::milliseconds(100)));
+            lock.unlock();
+            const bool abort = shouldAbort && shouldAbort();
+            lock.lock();
+            if (abort)
+                return Lease();
+        }
+    }
+
+    // 按指定 Key 预扣配额，不等待 (对冲与故障转移使用备用端点的固定 Key)；
+    // 该 Key 不由本调度器管理、正在冷却/隔离或配额不足时返回无效 Lease
+    Lease tryAcquire(const QString& key, int estimatedTokens) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto now = Clock::now();
+        refill(now);
+        for (int i = 0; i < static_cast<int>(m_keys.size()); ++i) {
+            if (m_keys[i].key == key)
+                return available(m_keys[i], now, estimatedTokens) ? take(i, estimatedTokens) : Lease();
+        }
+        return Lease();
+    }
+
+    // 归还 Key 并反馈 HTTP 结果；返回值描述本次触发的状态变化 (用于日志)
+    enum class Event { None, Cooldown, Quarantine };
+    Event release(const Lease& lease, int httpStatus, std::chrono::milliseconds retryAfter) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        KeyState* k = find(lease);
+        if (!k)
+            return Event::None;
+        k->inFlight = std::max(0, k->inFlight - 1);
+        Event ev = Event::None;
+        const auto now = Clock::now();
+        if (httpStatus == 429) {
+            k->throttled++;
+            k->consecutive429 = std::min(k->consecutive429 + 1, 6);
+            auto cool = retryAfter.count() > 0 ? retryAfter : std::chrono::milliseconds(5000LL << (k->consecutive429 - 1));
+            k->cooldownUntil = now + std::min(cool, std::chrono::milliseconds(120000));
+            ev = Event::Cooldown;
+        } else if (httpStatus == 401 || httpStatus == 403) {
+            k->errors++;
+            k->quarantinedUntil = now + QUARANTINE;
+            ev = Event::Quarantine;
+        } else if (httpStatus >= 200 && httpStatus < 300) {
+            k->consecutive429 = 0;
+        } else if (httpStatus != 0) {
+            k->errors++;
+        }
+        m_cv.notify_all();
+        return ev;
+    }
+
+    // 用实际 Token 用量校正预扣的 TPM 配额
+    void recordUsage(const Lease& lease, int actualTokens) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        KeyState* k = find(lease);
+        if (!k)
+            return;
+        k->tokens += static_cast<quint64>(std::max(0, actualTokens));
+        if (k->tpm > 0)
+            k->tpmTokens += lease.reservedTokens - actualTokens;
+    }
+
+    std::vector<KeyStats> stats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<KeyStats> out;
+        const auto now = Clock::now();
+        for (const KeyState& k : m_keys) {
+            KeyStats st;
+            st.label = label(k.key);
+            st.inFlight = k.inFlight;
+            st.requests = k.requests;
+            st.errors = k.errors;
+            st.throttled = k.throttled;
+            st.tokens = k.tokens;
+            st.rpmLimit = k.rpm;
+            st.tpmLimit = k.tpm;
+            st.cooldownMs = now < k.cooldownUntil ? std::chrono::duration_cast<std::chrono::milliseconds>(k.cooldownUntil - now).count() : 0;
+            st.quarantined = now < k.quarantinedUntil;
+            out.push_back(st);
+        }
+        return out;
+    }
+
+    // 脱敏显示：只保留首尾几位
+    static QString label(const QString& key) {
+        return key.size() > 10 ? key.left(5) + "…" + key.right(4) : QString("***");
+    }
+
+private:
+    struct KeyState {
+        QString key;
+        int rpm = 0;
+        int tpm = 0;
+        double rpmTokens = 0; // TPM 允许短暂为负 (实际用量超出预扣)
+        double tpmTokens = 0;
+        Clock::time_point lastRefill;
+        Clock::time_point cooldownUntil;
+        Clock::time_point quarantinedUntil;
+        int consecutive429 = 0;
+        int inFlight = 0;
+        quint64 requests = 0;
+        quint64 errors = 0;
+        quint64 throttled = 0;
+        quint64 tokens = 0;
+    };
+
+    bool available(const KeyState& k, Clock::time_point now, int estimatedTokens) const {
+        if (now < k.quarantinedUntil || now < k.cooldownUntil)
+            return false;
+        if (k.rpm > 0 && k.rpmTokens < 1.0)
+            return false;
+        return k.tpm <= 0 || k.tpmTokens >= std::min(estimatedTokens, k.tpm);
+    }
+
+    Lease take(int index, int estimatedTokens) {
+        KeyState& k = m_keys[index];
+        if (k.rpm > 0)
+            k.rpmTokens -= 1.0;
+        if (k.tpm > 0)
+            k.tpmTokens -= estimatedTokens;
+        k.inFlight++;
+        k.requests++;
+        Lease lease;
+        lease.index = index;
+        lease.key = k.key;
+        lease.reservedTokens = estimatedTokens;
+        return lease;
+    }
+
+    // 负载更低者优先；同负载时剩余 RPM 比例更高者优先
+    static bool better(const KeyState& a, const KeyState& b) {
+        if (a.inFlight != b.inFlight)
+            return a.inFlight < b.inFlight;
+        const double ra = a.rpm > 0 ? a.rpmTokens / a.rpm : 1.0;
+        const double rb = b.rpm > 0 ? b.rpmTokens / b.rpm : 1.0;
+        return ra > rb;
+    }
+
+    void refill(Clock::time_point now) {
+        for (KeyState& k : m_keys) {
+            const double minutes = std::chrono::duration<double>(now - k.lastRefill).count() / 60.0;
+            k.lastRefill = now;
+            if (k.rpm > 0)
+                k.rpmTokens = std::min<double>(k.rpm, k.rpmTokens + k.rpm * minutes);
+            if (k.tpm > 0)
+                k.tpmTokens = std::min<double>(k.tpm, k.tpmTokens + k.tpm * minutes);
+        }
+    }
+
+    KeyState* find(const Lease& lease) {
+        // 配置重载后下标可能变化，按 Key 内容校验
+        if (lease.index >= 0 && lease.index < static_cast<int>(m_keys.size()) && m_keys[lease.index].key == lease.key)
+            return &m_keys[lease.index];
+        for (KeyState& k : m_keys) {
+            if (k.key == lease.key)
+                return &k;
+        }
+        return nullptr;
+    }
+
+    static constexpr std::chrono::minutes QUARANTINE{10};
+
+    std::vector<KeyState> m_keys;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
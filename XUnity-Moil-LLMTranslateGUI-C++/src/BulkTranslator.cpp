@@ -0,0 +1,370 @@
+#include "BulkTranslator.h"
+#include "ConfigManager.h"
+#include "LogManager.h"
+#include "TranslationServer.h"
+#include "XuaTranslationIndex.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace
+{
+const char *BT_ERR_INPUT[] = {"Cannot open input file: %1", "无法打开输入文件：%1"};
+const char *BT_ERR_OUTPUT[] = {"Cannot open output file: %1", "无法打开输出文件：%1"};
+const char *BT_START[] = {
+    "Pre-translating %1 unique lines (%2 already done) in %3 batches, %4 parallel -> %5",
+    "开始预翻译：去重后 %1 条 (已完成 %2 条)，共 %3 批，并行 %4 -> %5"};
+const char *BT_PROGRESS[] = {
+    "[%1/%2] translated %3, failed %4",
+    "[%1/%2] 已翻译 %3 条，失败 %4 条"};
+const char *BT_DONE[] = {
+    "Done in %1 s: translated %2, failed %3, unchanged %4. Re-run the same command to retry failed lines.",
+    "完成，用时 %1 秒：翻译 %2 条，失败 %3 条，原样保留 %4 条。重新执行同一命令即可补译失败的条目。"};
+
+void printLine(FILE *stream, const QString &text)
+{
+    const QByteArray bytes = text.toUtf8();
+    std::fwrite(bytes.constData(), 1, static_cast<size_t>(bytes.size()), stream);
+    std::fputc('\n', stream);
+    std::fflush(stream);
+}
+}
+
+BulkTranslator::BulkTranslator(TranslationServer &server, const Options &options)
+    : m_server(server), m_options(options)
+{
+    if (m_options.outputPath.isEmpty())
+    {
+        const QFileInfo fi(m_options.inputPath);
+        m_options.outputPath = fi.dir().filePath(fi.completeBaseName() + "_translated.txt");
+    }
+}
+
+bool BulkTranslator::run(const std::function<void(const Summary &)> &progress, QString &error)
+{
+    m_summary = Summary();
+    const int lang = m_server.getConfig().language;
+
+    QStringList sources;
+    if (!readSources(sources, error))
+        return false;
+    m_summary.total = sources.size();
+
+    // 续跑：输出文件中已有的条目不再翻译
+    QStringList pending;
+    {
+        XuaTranslationIndex done;
+        if (QFileInfo::exists(m_options.outputPath))
+        {
+            std::atomic<bool> cancel{false};
+            done.loadFile(m_options.outputPath, cancel);
+        }
+        for (const QString &source : sources)
+        {
+            QString translation;
+            if (done.lookup(source, translation))
+                m_summary.resumed++;
+            else
+                pending << source;
+        }
+    }
+
+    QFile out(m_options.outputPath);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        error = QString(BT_ERR_OUTPUT[lang]).arg(m_options.outputPath);
+        return false;
+    }
+
+    const std::vector<QStringList> batches = makeBatches(pending);
+    m_summary.batches = static_cast<int>(batches.size());
+    const int jobs = std::clamp(m_options.jobs, 1, 64);
+    printLine(stdout, QString(BT_START[lang]).arg(m_summary.total).arg(m_summary.resumed).arg(m_summary.batches).arg(jobs).arg(m_options.outputPath));
+
+    // 每个线程领取下一批，翻译完成后整批追加写出 (写入与统计在锁内串行)
+    std::atomic<size_t> nextBatch{0};
+    std::mutex outMutex;
+    auto worker = [&]()
+    {
+        for (;;)
+        {
+            const size_t index = nextBatch++;
+            if (index >= batches.size())
+                return;
+            const QStringList &batch = batches[index];
+            const QStringList results = m_server.translateOffline(batch);
+
+            QByteArray chunk;
+            int translated = 0;
+            int failed = 0;
+            int unchanged = 0;
+            for (int i = 0; i < batch.size(); ++i)
+            {
+                if (results[i].isEmpty())
+                {
+                    failed++;
+                    continue;
+                }
+                if (results[i] == batch[i])
+                {
+                    unchanged++;
+                    continue;
+                }
+                chunk += (escape(batch[i]) + '=' + escape(results[i]) + '\n').toUtf8();
+                translated++;
+            }
+
+            std::lock_guard<std::mutex> lock(outMutex);
+            if (!chunk.isEmpty())
+            {
+                out.write(chunk);
+                out.flush();
+            }
+            m_summary.translated += translated;
+            m_summary.failed += failed;
+            m_summary.unchanged += unchanged;
+            m_summary.batchesDone++;
+            if (progress)
+                progress(m_summary);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < std::min<int>(jobs, m_summary.batches); ++i)
+        threads.emplace_back(worker);
+    for (std::thread &t : threads)
+        t.join();
+    return true;
+}
+
+int BulkTranslator::runCommandLine(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+#ifdef Q_OS_WIN
+    // GUI 子系统程序默认没有控制台：挂到启动它的命令行窗口上
+    if (AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+        std::freopen("CONOUT$", "w", stdout);
+        std::freopen("CONOUT$", "w", stderr);
+    }
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("XUnity LLM Translator - offline pre-translation of dumped game text");
+    parser.addHelpOption();
+    QCommandLineOption inputOption("pretranslate", "Text dump to translate (XUnity dump or one string per line).", "input");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Output file in _AutoGeneratedTranslations.txt format (appended, resumable).", "file");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs", "Batches in flight at once.", "n", "4");
+    QCommandLineOption tokensOption("batch-tokens", "Estimated source tokens per batch.", "n", "1500");
+    QCommandLineOption linesOption("batch-lines", "Maximum lines per batch.", "n", "40");
+    QCommandLineOption plainOption("plain", "Treat every line as source text (do not parse key=value).");
+    QCommandLineOption configOption("config", "Configuration file.", "file", "config.ini");
+    parser.addOption(inputOption);
+    parser.addOption(outputOption);
+    parser.addOption(jobsOption);
+    parser.addOption(tokensOption);
+    parser.addOption(linesOption);
+    parser.addOption(plainOption);
+    parser.addOption(configOption);
+    parser.process(app);
+
+    const AppConfig cfg = ConfigManager::loadConfig(parser.value(configOption));
+    const int lang = cfg.language;
+
+    Options options;
+    options.inputPath = parser.value(inputOption);
+    options.outputPath = parser.value(outputOption);
+    options.jobs = parser.value(jobsOption).toInt();
+    options.batchTokens = parser.value(tokensOption).toInt();
+    options.batchMaxLines = parser.value(linesOption).toInt();
+    options.plainLines = parser.isSet(plainOption);
+
+    TranslationServer server;
+    QObject::connect(&server, &TranslationServer::logMessage, [](const QString &msg)
+                     { printLine(stderr, LogManager::toPlainText(msg)); });
+    server.updateConfig(cfg);
+    server.startOffline();
+
+    BulkTranslator bulk(server, options);
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    const bool ok = bulk.run([lang](const Summary &s)
+                             { printLine(stdout, QString(BT_PROGRESS[lang]).arg(s.batchesDone).arg(s.batches).arg(s.translated).arg(s.failed)); },
+                             error);
+    server.stopOffline();
+
+    if (!ok)
+    {
+        printLine(stderr, error);
+        return 1;
+    }
+    const Summary &s = bulk.summary();
+    printLine(stdout, QString(BT_DONE[lang]).arg(timer.elapsed() / 1000).arg(s.translated).arg(s.failed).arg(s.unchanged));
+    return s.failed > 0 ? 2 : 0;
+}
+
+QString BulkTranslator::escape(const QString &text)
+{
+    QString out;
+    out.reserve(text.size() + 8);
+    for (const QChar c : text)
+    {
+        switch (c.unicode())
+        {
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        case '=':
+            out += "\\=";
+            break;
+        default:
+            out += c;
+            break;
+        }
+    }
+    return out;
+}
+
+bool BulkTranslator::readSources(QStringList &sources, QString &error) const
+{
+    QFile in(m_options.inputPath);
+    if (!in.open(QIODevice::ReadOnly))
+    {
+        error = QString(BT_ERR_INPUT[m_server.getConfig().language]).arg(m_options.inputPath);
+        return false;
+    }
+    QString content = QString::fromUtf8(in.readAll());
+    if (content.startsWith(QChar(0xFEFF)))
+        content.remove(0, 1);
+
+    QSet<QString> seen;
+    for (QString line : content.split('\n'))
+    {
+        if (line.endsWith('\r'))
+            line.chop(1);
+        if (line.trimmed().isEmpty())
+            continue;
+
+        QString source = line;
+        if (!m_options.plainLines)
+        {
+            const QString trimmed = line.trimmed();
+            // 跳过注释与正则规则 (r:"..." / sr:"...")
+            if (trimmed.startsWith("//") || trimmed.startsWith("r:\"") || trimmed.startsWith("sr:\""))
+                continue;
+
+            // 第一个未被转义的 '=' 是分隔符；没有分隔符的行整行即原文
+            const QByteArray bytes = trimmed.toUtf8();
+            const char *b = bytes.constData();
+            const char *e = b + bytes.size();
+            const char *sep = nullptr;
+            for (const char *p = b; p < e; ++p)
+            {
+                if (*p == '\\')
+                {
+                    ++p;
+                    continue;
+                }
+                if (*p == '=')
+                {
+                    sep = p;
+                    break;
+                }
+            }
+            if (!sep)
+            {
+                source = QString::fromStdString(XuaTranslationIndex::unescape(b, e));
+            }
+            else
+            {
+                const std::string key = XuaTranslationIndex::unescape(b, sep);
+                const std::string value = XuaTranslationIndex::unescape(sep + 1, e);
+                // 已经有译文的条目无需预翻译
+                if (!value.empty() && value != key)
+                    continue;
+                source = QString::fromStdString(key);
+            }
+        }
+
+        // 两种模式都去掉首尾空白：续跑时解析输出文件会裁掉行首行尾空白，原文必须与之一致才能对上
+        source = source.trimmed();
+        if (source.isEmpty() || seen.contains(source))
+            continue;
+        seen.insert(source);
+        sources << source;
+    }
+    return true;
+}
+
+std::vector<QStringList> BulkTranslator::makeBatches(const QStringList &sources) const
+{
+    const int budget = std::max(50, m_options.batchTokens);
+    const int maxLines = std::max(1, m_options.batchMaxLines);
+
+    std::vector<QStringList> batches;
+    QStringList current;
+    int tokens = 0;
+    for (const QString &source : sources)
+    {
+        // 多行文本无法按行编号对位，单独成批
+        if (source.contains('\n'))
+        {
+            batches.push_back(QStringList() << source);
+            continue;
+        }
+        const int cost = estimateTokens(source);
+        if (!current.isEmpty() && (tokens + cost > budget || current.size() >= maxLines))
+        {
+            batches.push_back(current);
+            current.clear();
+            tokens = 0;
+        }
+        current << source;
+        tokens += cost;
+    }
+    if (!current.isEmpty())
+        batches.push_back(current);
+    return batches;
+}
+
+int BulkTranslator::estimateTokens(const QString &text)
+{
+    int cjk = 0;
+    int other = 0;
+    for (const QChar c : text)
+    {
+        if (c.unicode() >= 0x2E80)
+            cjk++;
+        else
+            other++;
+    }
+    // 每行另计编号 [#n] 的开销
+    return cjk + (other + 3) / 4 + 3;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <vector>
+
+class TranslationServer;
+
+/**
+ * BulkTranslator - 离线批量预翻译 (命令行 --pretranslate)
+ * 作用：读取游戏文本转储 (XUnity 的未翻译文本转储，或任意每行一条的文本文件)，
+ *       去重后按 Token 预算打包成批次，以有限并行度送入与在线服务相同的翻译流水线
+ *       (冻结、术语表、修复、译文记忆)，结果以 _AutoGeneratedTranslations.txt 格式写出。
+ *       提前跑完一遍后，游戏内遇到这些文本时延迟为零。
+ * 可续跑：启动时读入输出文件中已有的条目并跳过；每批完成后立即追加落盘，中断后重跑即可接着翻。
+ */
+class BulkTranslator {
+public:
+    struct Options {
+        QString inputPath;
+        QString outputPath;      // 为空时写到输入文件旁的 <名称>_translated.txt
+        int jobs = 4;            // 同时在飞的批次数
+        int batchTokens = 1500;  // 每批原文的估算 Token 上限
+        int batchMaxLines = 40;  // 每批最多行数
+        bool plainLines = false; // 整行即原文，不解析 XUnity 的 "原文=译文" 格式
+    };
+
+    struct Summary {
+        int total = 0;      // 去重后的原文条数
+        int resumed = 0;    // 输出文件中已有、本次跳过的条数
+        int translated = 0;
+        int failed = 0;
+        int unchanged = 0;  // 无需翻译 (纯符号/数字等) 或译文与原文相同，不写出
+        int batches = 0;
+        int batchesDone = 0;
+    };
+
+    BulkTranslator(TranslationServer& server, const Options& options);
+
+    // 阻塞执行；progress 在每批完成后调用 (串行调用，可为空)。输入/输出文件无法打开时返回 false 并给出 error
+    bool run(const std::function<void(const Summary&)>& progress, QString& error);
+
+    const Summary& summary() const { return m_summary; }
+
+    // 命令行入口：main 发现 --pretranslate 参数时直接转交，不创建任何窗口
+    static int runCommandLine(int argc, char* argv[]);
+
+    // 按 XUnity 译文文件的规则转义 (\n、\r、\t、=、\)
+    static QString escape(const QString& text);
+
+private:
+    // 读取并去重输入文件中的原文 (保持首次出现的顺序)
+    bool readSources(QStringList& sources, QString& error) const;
+    std::vector<QStringList> makeBatches(const QStringList& sources) const;
+    // 粗略估算 Token：CJK 字符约 1 Token/字，其余约 4 字符/Token
+    static int estimateTokens(const QString& text);
+
+    TranslationServer& m_server;
+    Options m_options;
+    Summary m_summary;
+};
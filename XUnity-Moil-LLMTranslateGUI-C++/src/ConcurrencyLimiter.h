@@ -0,0 +1,266 @@
+#pragma once
+
+#include <QtGlobal>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+
+/**
+ * ConcurrencyLimiter - 上游并发的自适应限流器 (AIMD)
+ * 作用：限制同时在途的 LLM 调用数，超出的请求在条件变量上排队，不占用上游配额。
+ * 调整：
+ *   - 慢启动：尚未遇到过载时，每次成功 +1
+ *   - 拥塞避免：遇到过载后，每次成功 +1/limit (约每轮 +1)
+ *   - 过载 (429 / 5xx / 超时)：limit 减半，冷却期内只减一次，避免同一波失败把限额打到底
+ *   - 延迟连续多次明显高于平滑基线时轻微收缩；基线按优先级类分别维护
+ *     (40 行的批量请求与单条对话的耗时本就相差数倍，混在一起会把长批次误判为排队)
+ *   - Retry-After：在指定时间内暂停发放新的许可
+ * 排队：等待者按优先级类做加权公平排队 (WFQ，权重 8:3:1)，玩家正在等的单条对话优先于界面批量文本；
+ *       等待超过 agingMs 的请求按到达顺序优先放行，低优先级不会被饿死。
+ *       关闭自适应时限额固定为上限，仍按优先级排队。
+ * 放行：排队者按 (虚拟完成时间, 到达顺序) 与到达顺序各索引一份，许可空出时由归还方直接选出下一位、
+ *       代其占用许可并只唤醒这一位 (每位等待者各有一个条件变量)，放行一次为 O(log n)，不惊群。
+ *       shouldAbort 可能涉及系统调用 (探测客户端连接)，只在锁外调用。
+ */
+class ConcurrencyLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Signal {
+        Success,  // 正常应答，携带延迟样本
+        Overload, // 429 / 5xx / 超时
+        Ignore    // 与上游负载无关的结果 (取消、鉴权失败、本地网络错误等)
+    };
+
+    // 优先级类：[Custom] 单条对话、短批次、长批次
+    enum class Priority { Dialogue = 0, ShortBatch = 1, LongBatch = 2 };
+    static constexpr int PRIORITY_COUNT = 3;
+
+    struct ClassStats {
+        int queued = 0;
+        quint64 granted = 0;
+        quint64 aged = 0;       // 因等待过久而提前放行的次数
+        qint64 totalWaitMs = 0; // 累计排队时间
+        qint64 baselineMs = 0;  // 本类上游延迟的平滑基线
+    };
+
+    struct Stats {
+        int limit = 0;
+        int inFlight = 0;
+        int queued = 0;
+        quint64 overloads = 0;
+        qint64 pausedMs = 0;
+        ClassStats classes[PRIORITY_COUNT];
+    };
+
+    void configure(bool enabled, int minLimit, int maxLimit, int agingMs) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_enabled = enabled;
+        m_aging = std::chrono::milliseconds(std::max(0, agingMs));
+        m_min = std::max(1, minLimit);
+        m_max = std::max(m_min, maxLimit);
+        m_limit = std::clamp<double>(std::max(8, m_max / 4), m_min, m_max);
+        m_slowStart = true;
+        for (int i = 0; i < PRIORITY_COUNT; ++i) {
+            m_baselineMs[i] = 0;
+            m_slowStreak[i] = 0;
+        }
+        m_pausedUntil = Clock::time_point();
+        m_lastDecrease = Clock::time_point();
+        dispatch(Clock::now());
+    }
+
+    // 获取许可；shouldAbort 返回 true 时放弃排队并返回 false
+    bool acquire(Priority priority, const std::function<bool()>& shouldAbort) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const int cls = static_cast<int>(priority);
+        Waiter w;
+        w.id = ++m_nextTicket;
+        w.cls = cls;
+        w.enqueued = Clock::now();
+        // WFQ：虚拟完成时间 = max(虚拟时钟, 本类上一张票) + 1/权重，权重越大的类排得越密
+        w.tag = std::max(m_virtualTime, m_lastTag[cls]) + 1.0 / WEIGHTS[cls];
+        m_lastTag[cls] = w.tag;
+        m_byTag.insert(&w);
+        m_byArrival.emplace(w.id, &w);
+        m_queued[cls]++;
+        dispatch(w.enqueued);
+
+        // 放行由归还方完成；这里的定时醒来只为检查 shouldAbort 与 Retry-After 暂停到期
+        while (!w.granted) {
+            const auto now = Clock::now();
+            const auto wake = now >= m_pausedUntil ? now + std::chrono::milliseconds(100)
+                                                   : std::min(m_pausedUntil, now + std::chrono::milliseconds(100));
+            w.cv.wait_until(lock, wake);
+            if (w.granted)
+                break;
+            lock.unlock();
+            const bool abort = shouldAbort && shouldAbort();
+            lock.lock();
+            if (abort) {
+                if (w.granted)
+                    m_inFlight--; // 放弃时恰好被放行：交还许可
+                else
+                    unlink(w);
+                dispatch(Clock::now()); // 可能轮到下一位
+                return false;
+            }
+            dispatch(Clock::now());
+        }
+        return true;
+    }
+
+    // 不排队地尝试获取许可：只有无人排队、未暂停且仍有空余限额时成功 (对冲副本使用，不与排队者争抢)
+    bool tryAcquire() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_byArrival.empty() || Clock::now() < m_pausedUntil || m_inFlight >= currentLimit())
+            return false;
+        m_inFlight++;
+        return true;
+    }
+
+    // 归还许可并反馈结果 (priority 为获取许可时的优先级类，决定延迟样本计入哪条基线)；
+    // 整数限额发生变化时返回新值，否则返回 -1
+    int release(Signal signal, Priority priority, std::chrono::milliseconds latency,
+                std::chrono::milliseconds retryAfter = std::chrono::milliseconds(0)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_inFlight = std::max(0, m_inFlight - 1);
+        const int before = currentLimit();
+        const auto now = Clock::now();
+
+        if (retryAfter.count() > 0)
+            m_pausedUntil = std::max(m_pausedUntil, now + std::min(retryAfter, std::chrono::milliseconds(120000)));
+
+        if (signal == Signal::Overload) {
+            m_overloads++;
+            m_slowStart = false;
+            if (now - m_lastDecrease >= DECREASE_COOLDOWN) {
+                m_limit = std::max<double>(m_min, m_limit * 0.5);
+                m_lastDecrease = now;
+            }
+        } else if (signal == Signal::Success) {
+            const int cls = static_cast<int>(priority);
+            const double ms = static_cast<double>(latency.count());
+            double& baseline = m_baselineMs[cls];
+            if (baseline <= 0)
+                baseline = ms;
+            if (baseline > 0 && ms > baseline * 3) {
+                // 排队迹象：同类请求连续多次远高于基线才温和收缩，单个离群样本只是不再增长
+                if (++m_slowStreak[cls] >= SLOW_STREAK && now - m_lastDecrease >= DECREASE_COOLDOWN) {
+                    m_limit = std::max<double>(m_min, m_limit * 0.9);
+                    m_lastDecrease = now;
+                    m_slowStreak[cls] = 0;
+                }
+            } else {
+                m_slowStreak[cls] = 0;
+                m_limit = std::min<double>(m_max, m_limit + (m_slowStart ? 1.0 : 1.0 / m_limit));
+            }
+            baseline = baseline * 0.95 + ms * 0.05;
+        }
+
+        dispatch(now);
+        const int after = currentLimit();
+        return after != before ? after : -1;
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stats st;
+        st.limit = currentLimit();
+        st.inFlight = m_inFlight;
+        st.queued = static_cast<int>(m_byArrival.size());
+        for (int i = 0; i < PRIORITY_COUNT; ++i) {
+            st.classes[i] = m_classStats[i];
+            st.classes[i].queued = m_queued[i];
+            st.classes[i].baselineMs = static_cast<qint64>(m_baselineMs[i]);
+        }
+        st.overloads = m_overloads;
+        const auto now = Clock::now();
+        st.pausedMs = now < m_pausedUntil ? std::chrono::duration_cast<std::chrono::milliseconds>(m_pausedUntil - now).count() : 0;
+        return st;
+    }
+
+    // 队首 (最早到达且仍在排队) 的请求已等待的毫秒数：即当前的排队延迟，没有排队时为 0
+    qint64 headWaitMs() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_byArrival.empty())
+            return 0;
+        return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - m_byArrival.begin()->second->enqueued).count();
+    }
+
+private:
+    // 排队中的一位 (位于 acquire 的栈上，放行或放弃前一直挂在两个索引中)
+    struct Waiter {
+        quint64 id = 0;
+        int cls = 0;
+        double tag = 0;
+        Clock::time_point enqueued;
+        bool granted = false;
+        std::condition_variable cv;
+    };
+
+    struct ByTag {
+        bool operator()(const Waiter* a, const Waiter* b) const {
+            return a->tag != b->tag ? a->tag < b->tag : a->id < b->id;
+        }
+    };
+
+    int currentLimit() const { return m_enabled ? std::max(m_min, static_cast<int>(m_limit)) : m_max; }
+
+    void unlink(Waiter& w) {
+        m_byTag.erase(&w);
+        m_byArrival.erase(w.id);
+        m_queued[w.cls]--;
+    }
+
+    // 在限额内依次放行：先看最早到达者是否已等待超过 aging，否则取虚拟完成时间最小者。
+    // 代被选中者占用许可后只唤醒它 (调用方持有 m_mutex)
+    void dispatch(Clock::time_point now) {
+        while (!m_byArrival.empty() && now >= m_pausedUntil && m_inFlight < currentLimit()) {
+            Waiter* best = *m_byTag.begin();
+            Waiter* oldest = m_byArrival.begin()->second;
+            const bool aged = m_aging.count() > 0 && now - oldest->enqueued >= m_aging && oldest != best;
+            Waiter* w = aged ? oldest : best;
+            unlink(*w);
+            m_virtualTime = std::max(m_virtualTime, w->tag);
+            m_inFlight++;
+            ClassStats& cs = m_classStats[w->cls];
+            cs.granted++;
+            if (aged)
+                cs.aged++;
+            cs.totalWaitMs += std::chrono::duration_cast<std::chrono::milliseconds>(now - w->enqueued).count();
+            w->granted = true;
+            w->cv.notify_one();
+        }
+    }
+
+    static constexpr std::chrono::milliseconds DECREASE_COOLDOWN{2000};
+    static constexpr int SLOW_STREAK = 3; // 连续几个高延迟样本才视为排队
+    static constexpr double WEIGHTS[PRIORITY_COUNT] = {8.0, 3.0, 1.0};
+
+    bool m_enabled = false;
+    int m_min = 1;
+    int m_max = 64;
+    double m_limit = 16;
+    bool m_slowStart = true;
+    double m_baselineMs[PRIORITY_COUNT] = {0, 0, 0};
+    int m_slowStreak[PRIORITY_COUNT] = {0, 0, 0};
+    int m_inFlight = 0;
+    quint64 m_overloads = 0;
+    std::chrono::milliseconds m_aging{2000};
+    // 同一批等待者的两个索引：按 (虚拟完成时间, 到达顺序)；按到达顺序 (票号递增)
+    std::set<Waiter*, ByTag> m_byTag;
+    std::map<quint64, Waiter*> m_byArrival;
+    int m_queued[PRIORITY_COUNT] = {0, 0, 0};
+    quint64 m_nextTicket = 0;
+    double m_virtualTime = 0;
+    double m_lastTag[PRIORITY_COUNT] = {0, 0, 0};
+    ClassStats m_classStats[PRIORITY_COUNT];
+    Clock::time_point m_pausedUntil;
+    Clock::time_point m_lastDecrease;
+    mutable std::mutex m_mutex;
+};
@@ -212,6 +212,39 @@ AppConfig ConfigManager::loadConfig(const QString &filename)
     config.handle_rich_text = settings.value("Settings/handle_rich_text", false).toBool(); // 默认关闭
     config.extract_newline = settings.value("Settings/extract_newline", false).toBool(); // 默认开启
 
+    // --- ⚡ 服务端性能调优 ---
+    PerfConfig &perf = config.perf;
+    perf.enable_cache = settings.value("Performance/enable_cache", perf.enable_cache).toBool();
+    perf.cache_path = settings.value("Performance/cache_path", perf.cache_path).toString();
+    perf.cache_budget_mb = settings.value("Performance/cache_budget_mb", perf.cache_budget_mb).toInt();
+    perf.warm_start = settings.value("Performance/warm_start", perf.warm_start).toBool();
+    perf.negative_ttl_sec = settings.value("Performance/negative_ttl_sec", perf.negative_ttl_sec).toInt();
+    perf.negative_ttl_max_sec = settings.value("Performance/negative_ttl_max_sec", perf.negative_ttl_max_sec).toInt();
+    perf.prompt_cache_layout = settings.value("Performance/prompt_cache_layout", perf.prompt_cache_layout).toBool();
+    perf.upstream_io_threads = settings.value("Performance/upstream_io_threads", perf.upstream_io_threads).toInt();
+    perf.stream_upstream = settings.value("Performance/stream_upstream", perf.stream_upstream).toBool();
+    perf.upstream_max_connections = settings.value("Performance/upstream_max_connections", perf.upstream_max_connections).toInt();
+    perf.custom_batch_window_ms = settings.value("Performance/custom_batch_window_ms", perf.custom_batch_window_ms).toInt();
+    perf.custom_batch_max_chars = settings.value("Performance/custom_batch_max_chars", perf.custom_batch_max_chars).toInt();
+    perf.custom_batch_max_items = settings.value("Performance/custom_batch_max_items", perf.custom_batch_max_items).toInt();
+    perf.adaptive_concurrency = settings.value("Performance/adaptive_concurrency", perf.adaptive_concurrency).toBool();
+    perf.key_rpm_limit = settings.value("Performance/key_rpm_limit", perf.key_rpm_limit).toInt();
+    perf.key_tpm_limit = settings.value("Performance/key_tpm_limit", perf.key_tpm_limit).toInt();
+    perf.hedge_api_urls = settings.value("Performance/hedge_api_urls", perf.hedge_api_urls).toStringList();
+    perf.hedge_min_delay_ms = settings.value("Performance/hedge_min_delay_ms", perf.hedge_min_delay_ms).toInt();
+    perf.retry_max_attempts = settings.value("Performance/retry_max_attempts", perf.retry_max_attempts).toInt();
+    perf.retry_base_delay_ms = settings.value("Performance/retry_base_delay_ms", perf.retry_base_delay_ms).toInt();
+    perf.retry_max_delay_ms = settings.value("Performance/retry_max_delay_ms", perf.retry_max_delay_ms).toInt();
+    perf.retry_budget_ms = settings.value("Performance/retry_budget_ms", perf.retry_budget_ms).toInt();
+    perf.client_timeout_ms = settings.value("Performance/client_timeout_ms", perf.client_timeout_ms).toInt();
+    perf.upstream_timeout_ms = settings.value("Performance/upstream_timeout_ms", perf.upstream_timeout_ms).toInt();
+    perf.priority_aging_ms = settings.value("Performance/priority_aging_ms", perf.priority_aging_ms).toInt();
+    perf.http_max_threads = settings.value("Performance/http_max_threads", perf.http_max_threads).toInt();
+    perf.http_thread_stack_kb = settings.value("Performance/http_thread_stack_kb", perf.http_thread_stack_kb).toInt();
+    perf.admission_max_pending = settings.value("Performance/admission_max_pending", perf.admission_max_pending).toInt();
+    perf.admission_queue_budget_ms = settings.value("Performance/admission_queue_budget_ms", perf.admission_queue_budget_ms).toInt();
+    perf.drain_timeout_ms = settings.value("Performance/drain_timeout_ms", perf.drain_timeout_ms).toInt();
+
     return config;
 }
 
@@ -272,6 +305,39 @@ void ConfigManager::saveConfig(const AppConfig &config, const QString &filename)
     settings.setValue("Settings/enable_batch", config.enable_batch);
     settings.setValue("Settings/handle_rich_text", config.handle_rich_text);
     settings.setValue("Settings/extract_newline", config.extract_newline);
+
+    // --- ⚡ 服务端性能调优 ---
+    const PerfConfig &perf = config.perf;
+    settings.setValue("Performance/enable_cache", perf.enable_cache);
+    settings.setValue("Performance/cache_path", perf.cache_path);
+    settings.setValue("Performance/cache_budget_mb", perf.cache_budget_mb);
+    settings.setValue("Performance/warm_start", perf.warm_start);
+    settings.setValue("Performance/negative_ttl_sec", perf.negative_ttl_sec);
+    settings.setValue("Performance/negative_ttl_max_sec", perf.negative_ttl_max_sec);
+    settings.setValue("Performance/prompt_cache_layout", perf.prompt_cache_layout);
+    settings.setValue("Performance/upstream_io_threads", perf.upstream_io_threads);
+    settings.setValue("Performance/stream_upstream", perf.stream_upstream);
+    settings.setValue("Performance/upstream_max_connections", perf.upstream_max_connections);
+    settings.setValue("Performance/custom_batch_window_ms", perf.custom_batch_window_ms);
+    settings.setValue("Performance/custom_batch_max_chars", perf.custom_batch_max_chars);
+    settings.setValue("Performance/custom_batch_max_items", perf.custom_batch_max_items);
+    settings.setValue("Performance/adaptive_concurrency", perf.adaptive_concurrency);
+    settings.setValue("Performance/key_rpm_limit", perf.key_rpm_limit);
+    settings.setValue("Performance/key_tpm_limit", perf.key_tpm_limit);
+    settings.setValue("Performance/hedge_api_urls", perf.hedge_api_urls);
+    settings.setValue("Performance/hedge_min_delay_ms", perf.hedge_min_delay_ms);
+    settings.setValue("Performance/retry_max_attempts", perf.retry_max_attempts);
+    settings.setValue("Performance/retry_base_delay_ms", perf.retry_base_delay_ms);
+    settings.setValue("Performance/retry_max_delay_ms", perf.retry_max_delay_ms);
+    settings.setValue("Performance/retry_budget_ms", perf.retry_budget_ms);
+    settings.setValue("Performance/client_timeout_ms", perf.client_timeout_ms);
+    settings.setValue("Performance/upstream_timeout_ms", perf.upstream_timeout_ms);
+    settings.setValue("Performance/priority_aging_ms", perf.priority_aging_ms);
+    settings.setValue("Performance/http_max_threads", perf.http_max_threads);
+    settings.setValue("Performance/http_thread_stack_kb", perf.http_thread_stack_kb);
+    settings.setValue("Performance/admission_max_pending", perf.admission_max_pending);
+    settings.setValue("Performance/admission_queue_budget_ms", perf.admission_queue_budget_ms);
+    settings.setValue("Performance/drain_timeout_ms", perf.drain_timeout_ms);
     
     settings.sync();
 }
\ No newline at end of file
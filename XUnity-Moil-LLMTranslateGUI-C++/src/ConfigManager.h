@@ -4,6 +4,64 @@
 #include <QStringList>
 #include <QMap>
 
+// 服务端性能调优参数 (仅通过 config.ini 的 [Performance] 段配置，界面不直接暴露)
+// Server performance tuning (config.ini [Performance] section only, not exposed in UI)
+struct PerfConfig
+{
+    // 💾 译文记忆缓存开关
+    bool enable_cache = true;
+    // 译文记忆缓存文件 (追加写入，启动服务时内存映射加载)
+    QString cache_path = "translation_cache.bin";
+    // 译文记忆内存预算 (MB)，超出后按 W-TinyLFU 淘汰
+    int cache_budget_mb = 64;
+    // 🔥 启动服务时后台加载游戏已有的 XUnity 译文文件 (热启动)
+    bool warm_start = true;
+    // 🚫 负缓存：反复失败的文本冷却时间 (秒)，按连续失败次数指数翻倍，封顶 negative_ttl_max_sec；0 为关闭
+    int negative_ttl_sec = 30;
+    int negative_ttl_max_sec = 1800;
+    // ⚡ 提示词缓存友好布局：静态系统提示词在前、逐字节稳定，术语上下文随用户消息发送
+    bool prompt_cache_layout = false;
+    // 🚀 上游网络 I/O 线程数 (持有网络栈，工作线程只提交请求并等待)
+    int upstream_io_threads = 2;
+    // 🌊 流式请求上游 (stream=true)，译文长度/复读/Z-Code 失控时提前中止
+    bool stream_upstream = false;
+    // 🔌 上游 HTTP/1.1 连接总数上限 (HTTP/2 下单连接多路复用，不受此限)
+    int upstream_max_connections = 64;
+    // 📦 [Custom] 通道微批：聚合窗口 (毫秒，0 为关闭)、每批字符预算与条数上限
+    int custom_batch_window_ms = 0;
+    int custom_batch_max_chars = 2000;
+    int custom_batch_max_items = 32;
+    // 🎚️ 按延迟与 429/5xx 自适应调整上游并发 (AIMD)，上限为服务线程数
+    bool adaptive_concurrency = true;
+    // 🔑 每个 API Key 的默认 RPM / TPM 限额 (0 为不限)；单个 Key 可写作 "sk-xxx@RPM/TPM" 覆盖
+    int key_rpm_limit = 0;
+    int key_tpm_limit = 0;
+    // 🏁 对冲/故障转移的备用端点 ("地址" 或 "地址|模型"，空为关闭)：
+    // 请求超过主端点 p90 延迟 (不低于 hedge_min_delay_ms) 仍未完成时向备用端点补发，先到先得；
+    // 主端点硬错误时下一次重试直接改走备用端点
+    QStringList hedge_api_urls;
+    int hedge_min_delay_ms = 800;
+    // 🔁 重试策略：最多尝试次数、退避基数与上限 (毫秒，全抖动)、单个请求含全部重试的总预算 (毫秒，0 为不限)
+    int retry_max_attempts = 5;
+    int retry_base_delay_ms = 500;
+    int retry_max_delay_ms = 10000;
+    int retry_budget_ms = 90000;
+    // ⌛ 客户端 (XUnity) 等待一个请求的时间 (毫秒，0 为不限)：重试、对冲与每次上游尝试都在其内完成，
+    // 超出后直接放弃；单次上游尝试的超时上限为 upstream_timeout_ms
+    int client_timeout_ms = 60000;
+    int upstream_timeout_ms = 40000;
+    // ⚖️ 上游排队的优先级老化时间 (毫秒)：排队超过此时长的低优先级请求按到达顺序优先放行，0 为不老化
+    int priority_aging_ms = 2000;
+    // 🧵 HTTP 连接处理线程上限与线程栈大小 (KB)：线程按需创建、空闲回收，与上游并发数 (max_threads) 无关
+    int http_max_threads = 1024;
+    int http_thread_stack_kb = 512;
+    // 🚦 准入控制：服务内积压请求数上限，以及上游排队延迟预算 (毫秒)；超出时立即 503 + Retry-After，0 为不限
+    int admission_max_pending = 512;
+    int admission_queue_budget_ms = 20000;
+    // 🛬 停止服务时的排空时间 (毫秒)：拒绝新请求，进行中的翻译在此时间内完成并写入译文记忆，超时后强制中止；0 为立即中止
+    int drain_timeout_ms = 15000;
+};
+
 // 应用程序配置结构体
 // Application configuration struct
 struct AppConfig
@@ -70,6 +128,9 @@ struct AppConfig
     // 跨模式保护屏障标志
     bool is_from_modern = false;
 
+    // --- ⚡ 服务端性能调优 (仅 config.ini) ---
+    PerfConfig perf;
+
     // 备选提示词
     AppConfig()
     {
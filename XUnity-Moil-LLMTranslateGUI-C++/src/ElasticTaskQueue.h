@@ -0,0 +1,140 @@
+#pragma once
+
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "httplib.h"
+
+/**
+ * ElasticTaskQueue - 弹性的 HTTP 连接处理线程池 (替代 httplib::ThreadPool)
+ * 背景：httplib 是同步模型，处理函数返回之前无法把应答"挂起"再由别处补发，
+ *       所以每个待翻译的请求必然占住一个线程。能做的是让这个线程足够便宜：
+ *   - 上游网络栈已集中到 UpstreamDispatcher，工作线程不再持有 QNetworkAccessManager，
+ *     等待上游时只睡在条件变量上
+ *   - 线程使用小栈 (默认 512 KB，系统默认为 1~8 MB)，按需创建，空闲超过 keepAlive 后回收到 core 个
+ *   - 线程上限与上游并发 (max_threads / 自适应限流) 脱钩：上百个并发请求在限流器处按优先级廉价排队，
+ *     真正同时打到上游的仍只有限流器放行的那些
+ */
+class ElasticTaskQueue final : public httplib::TaskQueue {
+public:
+    // 运行统计：由服务对象持有，线程池 (随 listen 结束而销毁) 只负责更新
+    struct Counters {
+        std::atomic<int> live{0};
+        std::atomic<int> busy{0};
+        std::atomic<int> peak{0};
+        std::atomic<int> queued{0};
+        std::atomic<quint64> spawned{0};
+    };
+
+    ElasticTaskQueue(size_t coreThreads, size_t maxThreads, size_t stackBytes, Counters& counters)
+        : m_core(std::max<size_t>(1, coreThreads)), m_max(std::max(m_core, maxThreads)), m_stackBytes(stackBytes), m_counters(counters) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_core; ++i)
+            spawnLocked();
+    }
+
+    ~ElasticTaskQueue() override { shutdown(); }
+
+    bool enqueue(std::function<void()> fn) override {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_shutdown)
+                return false;
+            m_jobs.push_back(std::move(fn));
+            m_counters.queued = static_cast<int>(m_jobs.size());
+            // 没有空闲线程接手时按需扩容
+            if (m_idle < m_jobs.size() && m_live < m_max)
+                spawnLocked();
+        }
+        m_cv.notify_one();
+        return true;
+    }
+
+    void shutdown() override {
+        std::vector<QThread*> threads;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_shutdown && m_threads.empty())
+                return;
+            m_shutdown = true;
+            threads.swap(m_threads);
+        }
+        m_cv.notify_all();
+        for (QThread* t : threads) {
+            t->wait();
+            delete t;
+        }
+    }
+
+private:
+    void spawnLocked() {
+        // 顺手回收已经退出的空闲线程
+        m_threads.erase(std::remove_if(m_threads.begin(), m_threads.end(), [](QThread* t) {
+                            if (!t->isFinished())
+                                return false;
+                            t->wait();
+                            delete t;
+                            return true;
+                        }),
+                        m_threads.end());
+
+        QThread* t = QThread::create([this]() { workerLoop(); });
+        t->setObjectName("HttpWorker");
+        if (m_stackBytes > 0)
+            t->setStackSize(static_cast<uint>(m_stackBytes));
+        m_threads.push_back(t);
+        m_live++;
+        m_counters.live = static_cast<int>(m_live);
+        m_counters.peak = std::max(m_counters.peak.load(), static_cast<int>(m_live));
+        m_counters.spawned++;
+        t->start();
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_idle++;
+            const bool woke = m_cv.wait_for(lock, KEEP_ALIVE, [this]() { return !m_jobs.empty() || m_shutdown; });
+            m_idle--;
+            if (m_jobs.empty()) {
+                // 停止服务，或空闲超时且线程数多于常驻数：退出
+                if (m_shutdown || (!woke && m_live > m_core))
+                    break;
+                continue;
+            }
+            std::function<void()> fn = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_counters.queued = static_cast<int>(m_jobs.size());
+            lock.unlock();
+
+            m_counters.busy++;
+            fn();
+            m_counters.busy--;
+
+            lock.lock();
+        }
+        m_live--;
+        m_counters.live = static_cast<int>(m_live);
+    }
+
+    static constexpr std::chrono::seconds KEEP_ALIVE{30};
+
+    const size_t m_core;
+    const size_t m_max;
+    const size_t m_stackBytes;
+    Counters& m_counters;
+
+    std::vector<QThread*> m_threads;
+    std::deque<std::function<void()>> m_jobs;
+    size_t m_live = 0;
+    size_t m_idle = 0;
+    bool m_shutdown = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
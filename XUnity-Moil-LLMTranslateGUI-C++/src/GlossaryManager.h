@@ -92,6 +92,20 @@ public:
         appendToFile(key, value);
     }
 
+    // 原文命中的术语 (匹配规则与 getContextPrompt 一致) 的内容指纹，与顺序无关、跨会话稳定；
+    // 译文记忆按它分区，新学到的术语只使确实包含它的原文失效
+    // Fingerprint of the terms matching the text (same rule as getContextPrompt), order-independent and stable across sessions;
+    // the translation cache is keyed on it, so a newly learned term only invalidates texts that contain it
+    quint64 fingerprint(const QString& text) const {
+        QReadLocker locker(&m_lock);
+        quint64 fp = 0;
+        for (auto it = m_terms.constBegin(); it != m_terms.constEnd(); ++it) {
+            if (text.contains(it.key(), Qt::CaseInsensitive))
+                fp ^= termHash(it.key(), it.value());
+        }
+        return fp;
+    }
+
 private:
     // 私有构造函数 (单例模式)
     // Private constructor (Singleton pattern)
@@ -139,6 +153,18 @@ private:
         }
     }
 
+    // FNV-1a 64 位哈希 (qHash 每个进程的种子不同，不能用于持久化指纹)
+    // FNV-1a 64-bit hash (qHash is seeded per process, unusable for persistent fingerprints)
+    static quint64 termHash(const QString& key, const QString& value) {
+        const QByteArray bytes = (key + "=" + value).toUtf8();
+        quint64 h = 14695981039346656037ULL;
+        for (char c : bytes) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
     QString m_filePath;
     QMap<QString, QString> m_terms;
     // 读写锁，保护 m_terms 和文件写入操作
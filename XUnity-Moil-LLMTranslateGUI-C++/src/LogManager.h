@@ -5,6 +5,7 @@
 #include <QStringList>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QRegularExpression>
 #include <deque>
 #include <QDebug>
 
@@ -70,6 +71,17 @@ public:
         emit logsCleared();
     }
 
+    /**
+     * 日志转为纯文本 (去掉 HTML 标记)，供命令行/无界面模式输出到控制台
+     */
+    static QString toPlainText(const QString& html) {
+        static const QRegularExpression tagRegex("<[^>]*>");
+        QString plain = html;
+        plain.remove(tagRegex);
+        plain.replace("&lt;", "<").replace("&gt;", ">").replace("&amp;", "&");
+        return plain;
+    }
+
 signals:
     // 通知 UI 有新日志 (建议 UI 使用 Qt::QueuedConnection 连接此信号，虽然默认 Auto 也可以)
     void newLogAvailable(const QString& msg);
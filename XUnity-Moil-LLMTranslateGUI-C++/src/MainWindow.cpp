@@ -572,6 +572,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     connect(&LogManager::instance(), &LogManager::newLogAvailable, this, &MainWindow::onLogMessage);
     connect(&LogManager::instance(), &LogManager::logsCleared, logArea, &QTextEdit::clear);
     connect(server, &TranslationServer::tokenUsageReceived, m_tokenManager, &TokenManager::addUsage);
+    connect(server, &TranslationServer::apiKeyStatsUpdated, this, [this](const QString &summary)
+            { apiKeyEdit->setToolTip(summary); });
     connect(m_tokenManager, &TokenManager::tokensUpdated, this, &MainWindow::updateTokenDisplay);
     connect(m_hudWindow, &HudWindow::requestRestore, this, &MainWindow::restoreFromHud);
     connect(m_tokenManager, &TokenManager::tokensUpdated, [this](long long t, long long, long long)
@@ -692,7 +694,8 @@ MainWindow::~MainWindow()
         m_hudWindow->close();
         delete m_hudWindow;
     }
-    server->stopServer();
+    // 退出程序时不等待排空 / No drain on exit
+    server->stopServer(false);
 }
 
 void MainWindow::fadeOutAndClose()
@@ -1846,6 +1849,7 @@ AppConfig MainWindow::getUiConfig()
     cfg.glass_render_mode = savedCfg.glass_render_mode;
     cfg.hue_shift = savedCfg.hue_shift;
     cfg.tint_intensity = savedCfg.tint_intensity;
+    cfg.perf = savedCfg.perf; // 性能调优参数只存在于 config.ini
     // --- 🔥 核心修复结束 ---
 
     // 2. 收集当前 UI 上的状态 (覆盖 cfg 中的对应值)
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/**
+ * MicroBatcher - 单文本请求的微批聚合器
+ * 作用：[Custom] 通道每个 HTTP 请求只带一条文本。第一个到达的请求开启一个批次并担任组长，
+ *       在短暂的时间窗口内 (或攒满字符预算) 收集并发到达的其它文本，合并成一次多行请求，
+ *       结果按行分发回各自等待的请求，数 KB 的系统提示词每批只需支付一次。
+ * 分发：BatchFn 返回与输入等长的结果；某项为 nullopt 表示该行未能可靠对齐，
+ *       submit 返回 false，由调用方退回单条翻译。
+ * 取消：BatchFn 另收到一个探测函数，批内所有请求 (组长与仍在等待的组员) 都已放弃时返回 true，
+ *       执行方可据此中止上游调用；只要还有一位在等，整批就继续。
+ */
+class MicroBatcher {
+public:
+    using BatchFn = std::function<std::vector<std::optional<QString>>(const QStringList&, const std::function<bool()>& allGone)>;
+
+    struct Stats {
+        quint64 batches = 0;
+        quint64 items = 0;
+        quint64 fallbacks = 0;
+    };
+
+    void configure(int windowMs, int maxChars, int maxItems) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_window = std::chrono::milliseconds(std::max(0, windowMs));
+        m_maxChars = std::max(1, maxChars);
+        m_maxItems = std::max(1, maxItems);
+    }
+
+    bool enabled() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_window.count() > 0;
+    }
+
+    // 提交一条文本并等待批次结果；返回 false 表示需要调用方自行单条翻译
+    // shouldAbort：本请求不再等待结果；batchAbort：组长收集与执行整批时检查，为真则整批放弃
+    // (批内还有其他请求的文本，只与本请求相关的放弃条件不应放进 batchAbort)
+    bool submit(const QString& text, QString& result, const std::function<bool()>& shouldAbort,
+                const std::function<bool()>& batchAbort, const BatchFn& run) {
+        std::shared_ptr<Batch> batch;
+        int slot = -1;
+        bool isLeader = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_open) {
+                m_open = std::make_shared<Batch>();
+                m_open->deadline = std::chrono::steady_clock::now() + m_window;
+                isLeader = true;
+            }
+            batch = m_open;
+            if (!isLeader)
+                batch->followers++;
+            // 同批次内的相同文本共用一个槽位
+            slot = static_cast<int>(batch->texts.indexOf(text));
+            if (slot < 0) {
+                slot = static_cast<int>(batch->texts.size());
+                batch->texts.push_back(text);
+                batch->chars += static_cast<int>(text.size());
+            }
+            if (batch->chars >= m_maxChars || batch->texts.size() >= m_maxItems) {
+                // 攒满即封口，下一条文本开启新批次
+                m_open.reset();
+                batch->full = true;
+                batch->cv.notify_all();
+            }
+        }
+
+        if (isLeader) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!batch->full && std::chrono::steady_clock::now() < batch->deadline) {
+                lock.unlock();
+                const bool abort = batchAbort && batchAbort();
+                lock.lock();
+                if (abort)
+                    break;
+                batch->cv.wait_until(lock, std::min(batch->deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(50)));
+            }
+            if (m_open == batch)
+                m_open.reset();
+            const QStringList texts = batch->texts;
+            lock.unlock();
+
+            // 组员放弃时会自行减少计数；没有组员在等时，组长放弃即整批放弃
+            const std::function<bool()> allGone = [batch, &shouldAbort]() {
+                return batch->followers.load() == 0 && shouldAbort && shouldAbort();
+            };
+            std::vector<std::optional<QString>> results;
+            if (!(batchAbort && batchAbort()))
+                results = run(texts, allGone);
+            results.resize(texts.size());
+
+            lock.lock();
+            batch->results = std::move(results);
+            batch->done = true;
+            m_stats.batches++;
+            m_stats.items += static_cast<quint64>(texts.size());
+            batch->cv.notify_all();
+        }
+
+        // shouldAbort 可能探测客户端连接 (系统调用)，只在锁外调用，回来后再看一次批次状态
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!batch->done) {
+            batch->cv.wait_for(lock, std::chrono::milliseconds(100));
+            if (batch->done)
+                break;
+            lock.unlock();
+            const bool abort = shouldAbort && shouldAbort();
+            lock.lock();
+            if (abort && !batch->done) {
+                batch->followers--;
+                return false;
+            }
+        }
+        if (!isLeader)
+            batch->followers--;
+        const std::optional<QString>& r = batch->results[static_cast<size_t>(slot)];
+        if (!r) {
+            m_stats.fallbacks++;
+            return false;
+        }
+        result = *r;
+        return true;
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+private:
+    struct Batch {
+        QStringList texts;
+        int chars = 0;
+        bool full = false;
+        bool done = false;
+        // 仍在等待结果的组员数 (不含组长)
+        std::atomic<int> followers{0};
+        std::chrono::steady_clock::time_point deadline;
+        std::vector<std::optional<QString>> results;
+        std::condition_variable cv;
+    };
+
+    std::shared_ptr<Batch> m_open;
+    std::chrono::milliseconds m_window{0};
+    int m_maxChars = 2000;
+    int m_maxItems = 32;
+    Stats m_stats;
+    mutable std::mutex m_mutex;
+};
@@ -531,6 +531,10 @@ ModernWindow::ModernWindow(TranslationServer *server, QWidget *parent)
         connect(m_server, &TranslationServer::tokenUsageReceived,
                 m_tokenManager, &TokenManager::addUsage);
 
+        // 各 API Key 的实时统计 -> 密钥输入框的悬浮提示
+        connect(m_server, &TranslationServer::apiKeyStatsUpdated, this, [this](const QString &summary)
+                { apiKeyEdit->setToolTip(summary); });
+
         // 2. TokenManager 更新账本 -> 告诉 UI (刷新显示)
         // 注意：这里我们连接到了修改了签名后的 updateToken
         connect(m_tokenManager, &TokenManager::tokensUpdated,
@@ -653,8 +657,9 @@ void ModernWindow::closeEvent(QCloseEvent *event)
     // sess.setValue("Settings/lock_glossary_path", chkLockGlossary->isChecked());
     // sess.sync();
 
+    // 退出程序时不等待排空 | No drain on exit
     if (m_server)
-        m_server->stopServer();
+        m_server->stopServer(false);
 
     // 3. 创建退出动画组 (并行执行)
     // 3. Create exit animation group (parallel execution)
@@ -1857,6 +1862,7 @@ AppConfig ModernWindow::getUiConfig()
     AppConfig cfg;
     AppConfig savedCfg = ConfigManager::loadConfig(); // 先加载已有配置以继承不需要修改的值
     cfg.custom_api_urls = savedCfg.custom_api_urls;
+    cfg.perf = savedCfg.perf; // 性能调优参数只存在于 config.ini
 
     cfg.api_address = apiAddressCombo->currentText();
     cfg.api_key = apiKeyEdit->text();
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * NegativeCache - 失败文本的负缓存 (指数退避 TTL)
+ * 作用：反复产出无效译文 / 无法解析响应的文本，在 TTL 内直接快速失败，
+ *       不再让同一条坏文本每次都占用工作线程跑满整轮重试。
+ * TTL：base * 2^(连续失败次数 - 1)，封顶 maxTtl；成功一次即清除记录。
+ */
+class NegativeCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void configure(int baseTtlSec, int maxTtlSec) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_baseTtl = std::chrono::seconds(std::max(1, baseTtlSec));
+        m_maxTtl = std::chrono::seconds(std::max(baseTtlSec, maxTtlSec));
+    }
+
+    // 仍在冷却期内返回 true，并给出剩余秒数
+    bool isBlocked(const std::string& key, int& remainingSec) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it == m_entries.end())
+            return false;
+        const auto now = Clock::now();
+        if (now >= it->second.expiresAt)
+            return false;
+        remainingSec = static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(it->second.expiresAt - now).count()) + 1;
+        return true;
+    }
+
+    // 记录一次失败，返回本次设定的 TTL (秒)
+    int recordFailure(const std::string& key) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto now = Clock::now();
+        if (m_entries.size() >= MAX_ENTRIES)
+            pruneLocked(now);
+
+        Entry& e = m_entries[key];
+        e.failures = std::min(e.failures + 1, 20);
+        auto ttl = m_baseTtl * (1LL << std::min(e.failures - 1, 16));
+        if (ttl > m_maxTtl)
+            ttl = m_maxTtl;
+        e.expiresAt = now + ttl;
+        return static_cast<int>(ttl.count());
+    }
+
+    void clear(const std::string& key) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.erase(key);
+    }
+
+    void clearAll() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_entries.size();
+    }
+
+private:
+    struct Entry {
+        int failures = 0;
+        Clock::time_point expiresAt;
+    };
+
+    // 过期超过一个最大 TTL 的记录不再有参考价值
+    void pruneLocked(Clock::time_point now) {
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            if (now >= it->second.expiresAt + m_maxTtl)
+                it = m_entries.erase(it);
+            else
+                ++it;
+        }
+        // 仍然过多时整体清空，防止被海量坏文本撑爆
+        if (m_entries.size() >= MAX_ENTRIES)
+            m_entries.clear();
+    }
+
+    static const size_t MAX_ENTRIES = 8192;
+
+    std::unordered_map<std::string, Entry> m_entries;
+    std::chrono::seconds m_baseTtl{30};
+    std::chrono::seconds m_maxTtl{1800};
+    mutable std::mutex m_mutex;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QtGlobal>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <memory>
+
+/**
+ * RequestDeadline - 单个客户端请求的截止时间
+ * 作用：在 HTTP 处理函数里按配置的客户端超时生成，一路传入翻译、重试、对冲与每一次上游尝试，
+ *       所有等待 (Key 配额、并发许可、退避、上游应答) 都不超过客户端真正愿意等的时间；
+ *       客户端已经放弃的请求直接丢弃，不再继续消耗 Token。
+ * 客户端断开：可附带一个探测函数 (如 httplib 的 is_connection_closed)，客户端断开后 cancelled() 为真，
+ *       等待与重试随即结束，上游调用被中止。探测按 CANCEL_POLL_MS 节流，一旦断开即保持；副本共享探测状态。
+ * 默认构造的对象没有截止时间，也不探测断开。
+ */
+class RequestDeadline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    RequestDeadline() = default;
+
+    // budgetMs <= 0 表示不限
+    static RequestDeadline after(qint64 budgetMs) {
+        RequestDeadline d;
+        if (budgetMs > 0) {
+            d.m_limited = true;
+            d.m_at = Clock::now() + std::chrono::milliseconds(budgetMs);
+        }
+        return d;
+    }
+
+    // 返回附带断开探测的副本 (probe 为空则去掉探测)；probe 返回 true 表示客户端已经断开
+    RequestDeadline withCancelProbe(std::function<bool()> probe) const {
+        RequestDeadline d = *this;
+        d.m_cancel = probe ? std::make_shared<CancelState>(std::move(probe)) : nullptr;
+        return d;
+    }
+
+    bool limited() const { return m_limited; }
+    bool expired() const { return m_limited && Clock::now() >= m_at; }
+    bool cancellable() const { return m_cancel != nullptr; }
+    bool cancelled() const { return m_cancel && m_cancel->poll(); }
+    // 超时或客户端已断开：不必再为这个请求工作
+    bool abandoned() const { return expired() || cancelled(); }
+
+    // 剩余毫秒数 (已过期为 0；不限时返回一个很大的值)
+    qint64 remainingMs() const {
+        if (!m_limited)
+            return std::numeric_limits<qint64>::max() / 2;
+        return std::max<qint64>(0, std::chrono::duration_cast<std::chrono::milliseconds>(m_at - Clock::now()).count());
+    }
+
+    // 把一段等待时间压缩到截止时间之内
+    qint64 clamp(qint64 ms) const { return std::min(ms, remainingMs()); }
+
+private:
+    struct CancelState {
+        explicit CancelState(std::function<bool()> p) : probe(std::move(p)) {}
+
+        bool poll() {
+            if (gone.load(std::memory_order_relaxed))
+                return true;
+            const qint64 now = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+            qint64 last = lastPollMs.load();
+            if (now - last < CANCEL_POLL_MS || !lastPollMs.compare_exchange_strong(last, now))
+                return false;
+            if (probe())
+                gone = true;
+            return gone.load(std::memory_order_relaxed);
+        }
+
+        std::function<bool()> probe;
+        std::atomic<bool> gone{false};
+        std::atomic<qint64> lastPollMs{std::numeric_limits<qint64>::min() / 2};
+    };
+
+    static constexpr qint64 CANCEL_POLL_MS = 250;
+
+    bool m_limited = false;
+    Clock::time_point m_at;
+    std::shared_ptr<CancelState> m_cancel;
+};
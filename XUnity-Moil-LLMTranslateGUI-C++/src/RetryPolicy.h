@@ -0,0 +1,111 @@
+#pragma once
+
+#include <QRandomGenerator>
+#include <QtGlobal>
+#include <algorithm>
+#include <chrono>
+
+// 单次上游尝试的失败分类：只有"内容类"失败 (响应无法解析、译文被判无效) 才进入负缓存，
+// 网络/超时属于暂时性故障，不应让文本背锅
+enum class AttemptFailure {
+    None,
+    Aborted,
+    NoApiKey,
+    Network,     // 连接失败等传输层错误
+    Timeout,
+    BadResponse, // 应答无法解析
+    Rejected,    // 译文未通过校验 (或流式应答失控)
+    Throttled,   // 本地所有 Key 均处于冷却或限额中
+    RateLimited, // 上游 429
+    ServerError, // 上游 5xx
+    ClientError  // 上游 4xx (400/401/403/404 ...)，重试也不会成功
+};
+
+// 单次尝试的结果：失败分类 + 上游给出的 HTTP 状态与 Retry-After
+struct AttemptOutcome {
+    AttemptFailure failure = AttemptFailure::None;
+    int httpStatus = 0;
+    std::chrono::milliseconds retryAfter{0};
+};
+
+/**
+ * RetryPolicy - 按失败类型决定是否重试以及等待多久
+ * 规则：
+ *   - 中止、缺少 Key、4xx：立即放弃
+ *   - 429：优先遵守 Retry-After (再加少量抖动错开)，否则走指数退避
+ *   - 网络错误 / 超时 / 5xx / 本地 Key 受限：指数退避 + 全抖动 (Full Jitter)
+ *   - 应答无法解析 / 译文被拒：模型输出有随机性，短暂等待后重试，但最多 CONTENT_ATTEMPTS 次
+ *   - 整个请求 (含全部重试) 不超过总预算；剩余预算不够等待时直接放弃
+ * 线程：配置在服务启动时写入，之后只读；随机数取自线程安全的 QRandomGenerator::global()
+ */
+class RetryPolicy {
+public:
+    void configure(int maxAttempts, int baseDelayMs, int maxDelayMs, int budgetMs) {
+        m_maxAttempts = std::max(1, maxAttempts);
+        m_baseDelayMs = std::max(0, baseDelayMs);
+        m_maxDelayMs = std::max(m_baseDelayMs, maxDelayMs);
+        m_budgetMs = std::max(0, budgetMs);
+    }
+
+    int maxAttempts() const { return m_maxAttempts; }
+    int budgetMs() const { return m_budgetMs; }
+
+    // 第 attempt 次尝试 (从 1 开始) 失败后，返回下一次尝试前应等待的毫秒数；-1 表示放弃。
+    // elapsedMs 为本请求已耗费的时间；immediate 为 true 时 (例如改走备用端点) 不等待
+    qint64 nextDelayMs(const AttemptOutcome& outcome, int attempt, qint64 elapsedMs, bool immediate) const {
+        if (attempt >= m_maxAttempts)
+            return -1;
+
+        qint64 delay = 0;
+        switch (outcome.failure) {
+        case AttemptFailure::None:
+        case AttemptFailure::Aborted:
+        case AttemptFailure::NoApiKey:
+        case AttemptFailure::ClientError:
+            return -1;
+        case AttemptFailure::BadResponse:
+        case AttemptFailure::Rejected:
+            if (attempt >= CONTENT_ATTEMPTS)
+                return -1;
+            delay = jitter(m_baseDelayMs);
+            break;
+        case AttemptFailure::RateLimited:
+            if (outcome.retryAfter.count() > 0) {
+                delay = outcome.retryAfter.count() + jitter(m_baseDelayMs);
+                break;
+            }
+            delay = backoff(attempt);
+            break;
+        case AttemptFailure::Network:
+        case AttemptFailure::Timeout:
+        case AttemptFailure::Throttled:
+        case AttemptFailure::ServerError:
+            delay = backoff(attempt);
+            break;
+        }
+        if (immediate)
+            delay = 0;
+
+        if (m_budgetMs > 0 && elapsedMs + delay >= m_budgetMs)
+            return -1;
+        return delay;
+    }
+
+private:
+    // Full Jitter：在 [0, min(上限, 基数 * 2^(n-1))] 内均匀取值，避免大量请求同步重试
+    qint64 backoff(int attempt) const {
+        const qint64 cap = std::min<qint64>(m_maxDelayMs, static_cast<qint64>(m_baseDelayMs) << std::min(attempt - 1, 16));
+        return jitter(cap);
+    }
+
+    static qint64 jitter(qint64 upTo) {
+        return upTo > 0 ? static_cast<qint64>(QRandomGenerator::global()->bounded(static_cast<quint64>(upTo) + 1)) : 0;
+    }
+
+    static constexpr int CONTENT_ATTEMPTS = 3;
+
+    int m_maxAttempts = 5;
+    int m_baseDelayMs = 500;
+    int m_maxDelayMs = 10000;
+    int m_budgetMs = 90000;
+};
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include <string>
+#include "json.hpp"
+
+/**
+ * SseCompletionStream - 流式 (stream=true) Chat Completions 应答的增量解析与失控检测
+ * 作用：逐块解析 SSE 的 data: 行，累积 delta.content；同时实时剥离 <think> 推理块，
+ *       只对"可见译文"做退化检测，一旦判定失控就让调用方立即中止上游请求：
+ *   1. 长度失控：可见译文远长于原文
+ *   2. 复读失控：尾部出现同一片段的大量连续重复
+ *   3. 凭空出现原文中没有的 Z-Code (后续校验反正也会剥掉)
+ * 若上游无视 stream 参数直接返回完整 JSON，sawEvents() 为 false，调用方按普通应答解析。
+ * 开销：每块只检查新增部分 (字符计数、Z-Code) 与尾部有界窗口 (复读)，总开销与应答长度成线性。
+ * 线程：本类不加锁，只在上游 I/O 线程中被喂数据，完成后再由等待线程读取。
+ */
+class SseCompletionStream {
+public:
+    SseCompletionStream(size_t sourceChars, size_t sourceBytes, std::set<std::string> sourceZCodes)
+        : m_sourceZCodes(std::move(sourceZCodes)) {
+        m_maxVisibleChars = std::max<size_t>(200, sourceChars * 4 + 100);
+        m_repeatThreshold = std::max<size_t>(120, sourceBytes * 2);
+    }
+
+    // 喂入新到达的字节；返回 false 表示应当立即中止
+    bool feed(const char* data, size_t size) {
+        m_buffer.append(data, size);
+        size_t lineStart = 0;
+        for (;;) {
+            const size_t nl = m_buffer.find('\n', lineStart);
+            if (nl == std::string::npos)
+                break;
+            std::string line = m_buffer.substr(lineStart, nl - lineStart);
+            lineStart = nl + 1;
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            handleLine(line);
+        }
+        m_buffer.erase(0, lineStart);
+
+        if (!m_abortReason.empty())
+            return false;
+        scanVisible();
+        checkDegenerate();
+        return m_abortReason.empty();
+    }
+
+    bool sawEvents() const { return m_sawEvents; }
+    bool finished() const { return m_done; }
+    // 原始累积内容 (含推理块，交给既有的清洗流程处理)
+    const std::string& content() const { return m_content; }
+    const nlohmann::json& usage() const { return m_usage; }
+    // 非空表示已判定失控
+    const std::string& abortReason() const { return m_abortReason; }
+
+private:
+    void handleLine(const std::string& line) {
+        if (line.compare(0, 5, "data:") != 0)
+            return; // 注释行 (": keep-alive")、event:/id: 行一律忽略
+        size_t pos = 5;
+        while (pos < line.size() && line[pos] == ' ')
+            ++pos;
+        const std::string payload = line.substr(pos);
+        m_sawEvents = true;
+        if (payload == "[DONE]") {
+            m_done = true;
+            return;
+        }
+        nlohmann::json event = nlohmann::json::parse(payload, nullptr, false);
+        if (event.is_discarded())
+            return;
+        if (event.contains("usage") && event["usage"].is_object())
+            m_usage = event["usage"];
+        if (!event.contains("choices") || !event["choices"].is_array() || event["choices"].empty())
+            return;
+        const nlohmann::json& choice = event["choices"][0];
+        // 只取 content；reasoning_content 等推理通道直接丢弃
+        if (choice.contains("delta") && choice["delta"].is_object()) {
+            const nlohmann::json& delta = choice["delta"];
+            if (delta.contains("content") && delta["content"].is_string())
+                m_content += delta["content"].get<std::string>();
+        }
+    }
+
+    static bool startsWithCi(const std::string& s, size_t pos, const char* prefix) {
+        for (size_t i = 0; prefix[i]; ++i) {
+            if (pos + i >= s.size() || std::tolower(static_cast<unsigned char>(s[pos + i])) != prefix[i])
+                return false;
+        }
+        return true;
+    }
+
+    // 剩余字节还不足以判断是否为 <think / </think 标签
+    static bool maybeTagPrefix(const std::string& s, size_t pos) {
+        const size_t remain = s.size() - pos;
+        for (const char* tag : {"<think", "</think"}) {
+            if (remain >= std::char_traits<char>::length(tag))
+                continue;
+            size_t i = 0;
+            while (i < remain && std::tolower(static_cast<unsigned char>(s[pos + i])) == tag[i])
+                ++i;
+            if (i == remain)
+                return true;
+        }
+        return false;
+    }
+
+    // 增量剥离推理块，把新增的可见文本追加到 m_visible
+    void scanVisible() {
+        while (m_scanPos < m_content.size()) {
+            if (m_inThink) {
+                const size_t close = findCi(m_content, "</think", m_scanPos);
+                if (close == std::string::npos) {
+                    // 保留末尾几个字节，防止结束标签被切在两块之间
+                    if (m_content.size() > m_scanPos + 8)
+                        m_scanPos = m_content.size() - 8;
+                    return;
+                }
+                const size_t gt = m_content.find('>', close);
+                if (gt == std::string::npos)
+                    return;
+                m_inThink = false;
+                m_scanPos = gt + 1;
+                continue;
+            }
+
+            const size_t lt = m_content.find('<', m_scanPos);
+            if (lt == std::string::npos) {
+                m_visible.append(m_content, m_scanPos, std::string::npos);
+                m_scanPos = m_content.size();
+                return;
+            }
+            m_visible.append(m_content, m_scanPos, lt - m_scanPos);
+            m_scanPos = lt;
+            if (maybeTagPrefix(m_content, lt))
+                return; // 等待更多数据
+            const bool opens = startsWithCi(m_content, lt, "<think");
+            const bool closes = startsWithCi(m_content, lt, "</think");
+            if (!opens && !closes) {
+                m_visible.push_back('<');
+                m_scanPos = lt + 1;
+                continue;
+            }
+            const size_t gt = m_content.find('>', lt);
+            if (gt == std::string::npos)
+                return;
+            m_scanPos = gt + 1;
+            if (opens) {
+                m_inThink = true;
+            } else {
+                // 只有结束标签：之前的全部内容都是推理，检测从头开始
+                m_visible.clear();
+                m_checkedSize = 0;
+                m_visibleChars = 0;
+                m_zScanPos = 0;
+            }
+        }
+    }
+
+    static size_t findCi(const std::string& s, const char* needle, size_t from) {
+        for (size_t i = from; i < s.size(); ++i) {
+            if (startsWithCi(s, i, needle))
+                return i;
+        }
+        return std::string::npos;
+    }
+
+    void checkDegenerate() {
+        const size_t n = m_visible.size();
+        if (n == m_checkedSize)
+            return;
+
+        // 只统计新增字节中的 UTF-8 字符
+        for (size_t i = m_checkedSize; i < n; ++i) {
+            if ((static_cast<unsigned char>(m_visible[i]) & 0xC0) != 0x80)
+                ++m_visibleChars;
+        }
+        m_checkedSize = n;
+        if (m_visibleChars > m_maxVisibleChars) {
+            m_abortReason = "runaway length";
+            return;
+        }
+
+        // 尾部以周期 p (字节) 连续重复，且重复段足够长、次数足够多；
+        // 回溯到足以判定的长度即停止，每次检查的窗口与应答总长无关
+        for (size_t p = 1; p <= 96 && p * 6 <= n; ++p) {
+            const size_t window = std::min(n, std::max(m_repeatThreshold, p * 6));
+            size_t i = n - p;
+            while (i > n - window && m_visible[i - 1] == m_visible[i - 1 + p])
+                --i;
+            const size_t run = n - i;
+            if (run >= m_repeatThreshold && run / p >= 6) {
+                m_abortReason = "repetition loop";
+                return;
+            }
+        }
+
+        // Z-Code 只扫描新增部分 (含可能被切在两块之间的末尾 3 字节)
+        size_t i = m_zScanPos;
+        for (; i + 4 <= n; ++i) {
+            if (m_visible[i] == 'Z' && m_visible[i + 3] == 'Z' &&
+                std::isupper(static_cast<unsigned char>(m_visible[i + 1])) &&
+                std::isupper(static_cast<unsigned char>(m_visible[i + 2])) &&
+                !m_sourceZCodes.count(m_visible.substr(i, 4))) {
+                m_abortReason = "unexpected Z-code " + m_visible.substr(i, 4);
+                return;
+            }
+        }
+        m_zScanPos = i;
+    }
+
+    std::string m_buffer;
+    std::string m_content;
+    std::string m_visible;
+    size_t m_scanPos = 0;
+    size_t m_checkedSize = 0;  // 已做过字符计数的可见字节数
+    size_t m_visibleChars = 0;
+    size_t m_zScanPos = 0;     // 下一次 Z-Code 扫描的起点
+    bool m_inThink = false;
+    bool m_sawEvents = false;
+    bool m_done = false;
+    nlohmann::json m_usage;
+    std::string m_abortReason;
+
+    std::set<std::string> m_sourceZCodes;
+    size_t m_maxVisibleChars = 0;
+    size_t m_repeatThreshold = 0;
+};
@@ -0,0 +1,233 @@
+#include "TranslationCache.h"
+#include <QtEndian>
+#include <QByteArray>
+#include <QSaveFile>
+#include <cstring>
+
+namespace
+{
+const char CACHE_MAGIC[] = "XTMC0001";
+const qint64 CACHE_MAGIC_SIZE = 8;
+const qint64 RECORD_HEADER_SIZE = 8;
+// 单条记录上限：超过即视为文件损坏，停止解析
+const quint32 MAX_FIELD_SIZE = 4 * 1024 * 1024;
+}
+
+bool TranslationCache::open(const QString &path, size_t budgetBytes, const std::atomic<bool> &cancel)
+{
+    close();
+
+    // 映射、解析与压缩都在局部的文件与索引上完成，不持锁：加载期间服务照常运行
+    WTinyLfuIndex index(budgetBytes);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+
+    const qint64 fileSize = file.size();
+    qint64 validEnd = 0;
+
+    // 解析映射区中的全部记录，返回最后一条完整记录的结束位置
+    auto parseRecords = [&index, &cancel, fileSize](const uchar *base) -> qint64
+    {
+        if (std::memcmp(base, CACHE_MAGIC, CACHE_MAGIC_SIZE) != 0)
+            return 0;
+        qint64 pos = CACHE_MAGIC_SIZE;
+        while (pos + RECORD_HEADER_SIZE <= fileSize)
+        {
+            if (cancel.load(std::memory_order_relaxed))
+                return -1;
+            const quint32 keyLen = qFromLittleEndian<quint32>(base + pos);
+            const quint32 valLen = qFromLittleEndian<quint32>(base + pos + 4);
+            if (keyLen == 0 || keyLen > MAX_FIELD_SIZE || valLen > MAX_FIELD_SIZE)
+                break;
+            if (pos + RECORD_HEADER_SIZE + keyLen + valLen > fileSize)
+                break; // 残缺尾记录
+            const char *keyPtr = reinterpret_cast<const char *>(base + pos + RECORD_HEADER_SIZE);
+            index.put(std::string(keyPtr, keyLen), std::string(keyPtr + keyLen, valLen));
+            pos += RECORD_HEADER_SIZE + keyLen + valLen;
+        }
+        return pos;
+    };
+
+    if (fileSize >= CACHE_MAGIC_SIZE)
+    {
+        uchar *base = file.map(0, fileSize);
+        if (base)
+        {
+            validEnd = parseRecords(base);
+            file.unmap(base);
+        }
+        else
+        {
+            // 映射失败 (如网络盘)：退化为一次性读取
+            file.seek(0);
+            const QByteArray bytes = file.readAll();
+            if (bytes.size() == fileSize)
+                validEnd = parseRecords(reinterpret_cast<const uchar *>(bytes.constData()));
+        }
+    }
+    if (validEnd < 0)
+        return false; // 已取消，文件保持原样
+
+    if (validEnd == 0)
+    {
+        // 新文件或魔数不符：重建文件头
+        index.clear();
+        file.resize(0);
+        file.seek(0);
+        file.write(CACHE_MAGIC, CACHE_MAGIC_SIZE);
+        validEnd = CACHE_MAGIC_SIZE;
+    }
+    else if (validEnd < fileSize)
+    {
+        file.resize(validEnd);
+    }
+
+    // 被淘汰或被覆盖的记录过多时压缩重写，防止文件无限增长 (失败时保留原文件继续追加)
+    if (validEnd > static_cast<qint64>(index.bytes()) * 2 + 1024 * 1024)
+        compact(file, index);
+    if (!file.isOpen() || cancel.load(std::memory_order_relaxed))
+        return false;
+
+    file.seek(file.size());
+    file.flush();
+    file.close();
+
+    // 加载完成：在锁内接管文件与索引
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite))
+        return false;
+    m_file.seek(m_file.size());
+    m_index = std::move(index);
+    m_hits = 0;
+    m_misses = 0;
+    return true;
+}
+
+bool TranslationCache::compact(QFile &file, const WTinyLfuIndex &index)
+{
+    const QString path = file.fileName();
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly))
+    {
+        file.seek(file.size());
+        return false;
+    }
+    out.write(CACHE_MAGIC, CACHE_MAGIC_SIZE);
+    // 冷数据在前、热数据在后：下次加载时热数据最后进入索引，最不容易被淘汰
+    index.forEach([&out](const std::string &key, const std::string &value)
+                    {
+        QByteArray header;
+        header.resize(RECORD_HEADER_SIZE);
+        qToLittleEndian<quint32>(static_cast<quint32>(key.size()), header.data());
+        qToLittleEndian<quint32>(static_cast<quint32>(value.size()), header.data() + 4);
+        out.write(header);
+        out.write(key.data(), static_cast<qint64>(key.size()));
+        out.write(value.data(), static_cast<qint64>(value.size())); });
+
+    file.close();
+    const bool committed = out.commit();
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+    file.seek(file.size());
+    return committed;
+}
+
+void TranslationCache::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.isOpen())
+    {
+        m_file.flush();
+        m_file.close();
+    }
+    m_index.clear();
+}
+
+bool TranslationCache::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file.isOpen();
+}
+
+bool TranslationCache::lookup(const std::string &key, std::string &value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::string *found = m_index.find(key);
+    if (!found)
+    {
+        m_misses++;
+        return false;
+    }
+    m_hits++;
+    value = *found;
+    return true;
+}
+
+void TranslationCache::insert(const std::string &key, const std::string &value)
+{
+    if (key.empty() || value.empty() || key.size() > MAX_FIELD_SIZE || value.size() > MAX_FIELD_SIZE)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.isOpen())
+        return;
+
+    const std::string *existing = m_index.peek(key);
+    if (existing && *existing == value)
+        return; // 完全相同的记录无需重复落盘
+
+    m_index.put(key, value);
+    appendRecord(key, value);
+}
+
+size_t TranslationCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index.size();
+}
+
+TranslationCache::Stats TranslationCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats st;
+    st.hits = m_hits;
+    st.misses = m_misses;
+    st.evictions = m_index.evictions();
+    st.entries = m_index.size();
+    st.bytes = m_index.bytes();
+    st.budget = m_index.budget();
+    st.fileBytes = m_file.isOpen() ? m_file.size() : 0;
+    return st;
+}
+
+bool TranslationCache::appendRecord(const std::string &key, const std::string &value)
+{
+    QByteArray record;
+    record.resize(RECORD_HEADER_SIZE);
+    qToLittleEndian<quint32>(static_cast<quint32>(key.size()), record.data());
+    qToLittleEndian<quint32>(static_cast<quint32>(value.size()), record.data() + 4);
+    record.append(key.data(), static_cast<qsizetype>(key.size()));
+    record.append(value.data(), static_cast<qsizetype>(value.size()));
+
+    // 单次写入整条记录，降低崩溃时产生残缺记录的概率
+    const bool ok = m_file.write(record) == record.size();
+    m_file.flush();
+    return ok;
+}
+
+std::string TranslationCache::makeKey(const QString &ns, const QString &text)
+{
+    std::string key = ns.toStdString();
+    key.push_back('\x1f');
+    key += normalize(text).toStdString();
+    return key;
+}
+
+QString TranslationCache::normalize(const QString &text)
+{
+    QString normalized = text;
+    normalized.replace("\r\n", "\n");
+    return normalized.trimmed();
+}
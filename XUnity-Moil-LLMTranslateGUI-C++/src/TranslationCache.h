@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QString>
+#include <QFile>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include "WTinyLfu.h"
+
+/**
+ * TranslationCache - 持久化译文记忆 (Translation Memory)
+ * 作用：在 LLM 往返之前拦截重复文本，命中时直接返回历史译文。
+ * 存储：紧凑的追加写入文件，启动服务时整体内存映射并重建索引。
+ *       加载在锁外进行 (调用方放到后台线程)，完成前 isOpen() 为 false，查询一律未命中、写入被忽略。
+ * 内存：索引受字节预算约束，采用 W-TinyLFU 准入/淘汰，抗一次性扫描冲刷。
+ *
+ * 文件格式 (小端序)：
+ *   [8B 魔数 "XTMC0001"] { [u32 keyLen][u32 valLen][key][value] } ...
+ * 同一个 key 出现多次时以最后一条为准；崩溃产生的残缺尾记录会在加载时被截断。
+ * 文件明显大于内存中的存活数据时，加载后会压缩重写。
+ */
+class TranslationCache {
+public:
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t budget = 0;
+        qint64 fileBytes = 0;
+    };
+
+    TranslationCache() = default;
+    ~TranslationCache() { close(); }
+
+    TranslationCache(const TranslationCache&) = delete;
+    TranslationCache& operator=(const TranslationCache&) = delete;
+
+    // 打开 (或创建) 缓存文件，内存映射后在预算内重建索引；cancel 置位时中途放弃并返回 false
+    bool open(const QString& path, size_t budgetBytes, const std::atomic<bool>& cancel);
+    void close();
+    bool isOpen() const;
+
+    // 查询：命中返回 true 并写入 value
+    bool lookup(const std::string& key, std::string& value);
+    // 写入：更新索引并追加到磁盘
+    void insert(const std::string& key, const std::string& value);
+
+    size_t size() const;
+    Stats stats() const;
+
+    // 构造缓存键：命名空间 (模型/提示词/术语表指纹) + 归一化原文
+    static std::string makeKey(const QString& ns, const QString& text);
+    // 原文归一化：统一换行并去除首尾空白
+    static QString normalize(const QString& text);
+
+private:
+    bool appendRecord(const std::string& key, const std::string& value);
+    // 只保留索引中存活的条目，原子地重写磁盘文件 (file 随后重新打开)
+    static bool compact(QFile& file, const WTinyLfuIndex& index);
+
+    QFile m_file;
+    WTinyLfuIndex m_index;
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+    mutable std::mutex m_mutex;
+};
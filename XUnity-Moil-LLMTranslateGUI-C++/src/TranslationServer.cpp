@@ -4,7 +4,7 @@
 #include "RegexManager.h"
 #include "LogManager.h"
 #include "XuaConfigHijacker.h"
-#include <QEventLoop>
+#include "SseCompletionStream.h"
 #include <QCryptographicHash>
 #include <QRegularExpression>
 #include <QRandomGenerator>
@@ -14,14 +14,70 @@
 #include <QTimer>
 #include <QElapsedTimer>
 #include <QSet>
+#include <QHash>
+#include <QFileInfo>
+#include <QDateTime>
 #include <regex>
 #include <chrono>
 #include <thread>
 #include <algorithm>
 #include <memory> // 🔥 引入现代C++智能指针
+#include <set>
 
 using json = nlohmann::json;
 
+// 翻译协议：追加在用户系统提示词之后 (配置更新时连同系统提示词一起预先转成 UTF-8)
+static const char TRANSLATION_PROTOCOL[] = "\n\n【Translation Protocol (STRICT)】:\n"
+                                       "0. 🛡️ PRIORITY: TAGS/VARS/Z-CODES > GRAMMAR > STYLE. Never break code structures.\n"
+                                       "1. 📤 OUTPUT: Return ONLY the translated result. NO explanations. NO markdown.\n"
+                                       "2. 🧱 IMMUTABLES (KEEP EXACTLY):\n"
+                                       "   - [T_0], [T_1] ... : Placeholder tokens.\n"
+                                       "   - [LF] : Line break.\n"
+                                       "   - {{A}}, {{B}} ... : Variables. NEVER translate letters inside.\n"
+                                       "3. 📦 CONTAINERS (TRANSLATE CONTENT, KEEP WRAPPERS):\n"
+                                       "   - Z-Codes: 'Z[A-Z]{2}Z ... Z[A-Z]{2}Z'. Keep markers, translate inside.\n"
+                                       "   - HTML: '<tag>text</tag>'. Keep tags, translate 'text'.\n"
+                                       "4. 💬 PUNCTUATION & FORMAT:\n"
+                                       "   - Convert punctuation in visible text ONLY.\n"
+                                       "   - Do NOT modify punctuation inside tags.\n"
+                                       "   - Preserve spacing around tags.\n"
+                                       "5. 🧠 TRANSLATION LOGIC:\n"
+                                       "   - Treat input as independent UI fragments.\n"
+                                       "6. 🚫 ANTI-HALLUCINATION (CRITICAL):\n"
+                                       "   - DO NOT add <size>, <color>, <b>, <i> or brackets like [size=...] if they are not in the input.\n"
+                                       "   - DO NOT try to fix or close tags. Just keep exactly what you see.\n"
+                                       "   - DO NOT invent speaker names. DO NOT output </T_0>.\n"
+                                       "7. 🚨 FINAL SAFETY CHECK:\n"
+                                       "   - All tags closed\n"
+                                       "   - All {{X}} preserved\n"
+                                       "   - No new Z-codes created\n";
+
+// 📦 编号批次的附加指令：随用户消息发送，系统提示词保持稳定
+static const char BATCH_PROTOCOL[] = "【Numbered Lines】: Every line below starts with a [#n] marker and is a separate text.\n"
+                                     "Translate each line on its own and return exactly one line per input line, "
+                                     "starting with the same [#n] marker. Never merge, split, reorder or drop lines, "
+                                     "and never translate or renumber the markers.\n\n";
+
+// 不超过此规模的 Google 通道批次按短批次调度
+static const int SHORT_BATCH_MAX_LINES = 4;
+static const int SHORT_BATCH_MAX_CHARS = 400;
+
+// 解析 Retry-After：秒数或 HTTP 日期；无法解析时返回 0
+static std::chrono::milliseconds parseRetryAfter(const QByteArray &value)
+{
+    const QByteArray trimmed = value.trimmed();
+    if (trimmed.isEmpty())
+        return std::chrono::milliseconds(0);
+    bool ok = false;
+    const double seconds = trimmed.toDouble(&ok);
+    if (ok)
+        return std::chrono::milliseconds(static_cast<qint64>(std::max(0.0, seconds) * 1000));
+    const QDateTime when = QDateTime::fromString(QString::fromLatin1(trimmed), Qt::RFC2822Date);
+    if (!when.isValid())
+        return std::chrono::milliseconds(0);
+    return std::chrono::milliseconds(std::max<qint64>(0, QDateTime::currentDateTimeUtc().msecsTo(when)));
+}
+
 // ==========================================
 // 日志与常量 (HTML Optimized)
 // ==========================================
@@ -31,6 +87,18 @@ const char *SV_LOG_START[] = {
 const char *SV_LOG_STOP[] = {
     "<font color='#F44336'><b>Server stopped</b></font>",
     "<font color='#F44336'><b>服务已停止</b></font>"};
+const char *SV_ERR_LISTEN[] = {
+    "<font color='#F44336'><b>Cannot listen on port %1</b></font> (already in use?)",
+    "<font color='#F44336'><b>无法监听端口 %1</b></font>（端口被占用？）"};
+const char *SV_DRAIN_START[] = {
+    "<font color='#FF9800'>🛬 Draining: waiting for %1 in-flight requests (up to %2 ms), new requests are rejected</font>",
+    "<font color='#FF9800'>🛬 排空中：等待 %1 个进行中的请求完成 (最长 %2 ms)，新请求将被拒绝</font>"};
+const char *SV_DRAIN_DONE[] = {
+    "<font color='#4CAF50'>🛬 Drain complete in %1 ms</font>",
+    "<font color='#4CAF50'>🛬 进行中的请求已全部完成，用时 %1 ms</font>"};
+const char *SV_DRAIN_TIMEOUT[] = {
+    "<font color='#F44336'>🛬 Drain deadline reached, aborting %1 remaining requests</font>",
+    "<font color='#F44336'>🛬 排空超时，强制中止剩余 %1 个请求</font>"};
 const char *SV_LOG_REQ_PREFIX[] = {
     "Request received: ",
     "收到请求: "};
@@ -43,7 +111,68 @@ const char *SV_NEW_TERM[] = {
 const char *SV_RETRY_ATTEMPT[] = {"🔄 Retry translation (%1/%2): ", "🔄 重试翻译 (%1/%2): "};
 const char *SV_RETRY_SUCCESS[] = {"<font color='#4CAF50'>✅ Retry successful</font>", "<font color='#4CAF50'>✅ 重试成功</font>"};
 const char *SV_RETRY_FAILED[] = {"<font color='#F44336'>❌ Retry failed, skipping text</font>", "<font color='#F44336'>❌ 重试失败，跳过文本</font>"};
+const char *SV_DEADLINE_EXCEEDED[] = {"<font color='#FF9800'>⌛ Client deadline reached, dropping request</font>", "<font color='#FF9800'>⌛ 已超出客户端等待时间，放弃该请求</font>"};
+const char *SV_CLIENT_GONE[] = {"<font color='#FF9800'>🔌 Client disconnected, cancelling upstream request</font>", "<font color='#FF9800'>🔌 客户端已断开，取消上游请求</font>"};
+const char *SV_RETRY_GIVE_UP[] = {"<font color='#F44336'>❌ Non-retryable error (HTTP %1), skipping text</font>", "<font color='#F44336'>❌ 不可重试的错误 (HTTP %1)，跳过文本</font>"};
 const char *SV_ABORTED[] = {"⛔ Translation Aborted", "⛔ 翻译已终止"};
+const char *SV_CACHE_LOADED[] = {
+    "💾 Translation memory loaded: %1 entries (%2 ms)",
+    "💾 译文记忆已加载：%1 条 (%2 ms)"};
+const char *SV_CACHE_FAILED[] = {
+    "<font color='#F44336'>❌ Failed to open translation memory: %1</font>",
+    "<font color='#F44336'>❌ 译文记忆文件打开失败：%1</font>"};
+const char *SV_COALESCED[] = {"<font color='#9E9E9E'>🛬 Joined in-flight translation</font>", "<font color='#9E9E9E'>🛬 已合并到进行中的相同请求</font>"};
+const char *SV_WARM_LOADED[] = {
+    "🔥 Warm start: %1 existing translations indexed from %2 file(s) (%3 ms)",
+    "🔥 热启动：已从 %2 个文件索引 %1 条已有译文 (%3 ms)"};
+const char *SV_TEMPLATE_HIT[] = {"<font color='#9E9E9E'>🧩 Template cache hit</font>", "<font color='#9E9E9E'>🧩 命中模板记忆</font>"};
+const char *SV_CACHE_STATS[] = {
+    "💾 Cache stats: hits %1, misses %2, evictions %3, entries %4, %5 / %6 KB",
+    "💾 译文记忆统计：命中 %1，未命中 %2，淘汰 %3，条目 %4，占用 %5 / %6 KB"};
+const char *SV_CACHE_HIT[] = {"<font color='#9E9E9E'>💾 Cache hit</font>", "<font color='#9E9E9E'>💾 命中译文记忆</font>"};
+const char *SV_NEGATIVE_HIT[] = {
+    "<font color='#9E9E9E'>🚫 Known-bad text skipped (cooldown %1 s left)</font>",
+    "<font color='#9E9E9E'>🚫 已知失败文本，跳过 (冷却剩余 %1 秒)</font>"};
+const char *SV_PROMPT_CACHE[] = {
+    "<font color='#9E9E9E'>⚡ Prompt cache: %1 / %2 prompt tokens cached</font>",
+    "<font color='#9E9E9E'>⚡ 提示词缓存：%2 个输入 Token 中命中 %1 个</font>"};
+const char *SV_STREAM_ABORTED[] = {
+    "<font color='#FF9800'>✂️ Stream aborted early: %1</font>",
+    "<font color='#FF9800'>✂️ 流式输出失控，已提前中止：%1</font>"};
+const char *SV_POOL_STATS[] = {
+    "🔌 Upstream %1: %2 requests, %3 new TLS handshakes, %4 over HTTP/2",
+    "🔌 上游 %1：请求 %2 次，新建 TLS 握手 %3 次，HTTP/2 承载 %4 次"};
+const char *SV_MICRO_BATCH[] = {
+    "<font color='#9E9E9E'>📦 Micro-batch: %1 texts in one request, %2 routed</font>",
+    "<font color='#9E9E9E'>📦 微批：%1 条文本合并为一次请求，成功分发 %2 条</font>"};
+const char *SV_LIMIT_DOWN[] = {
+    "<font color='#FF9800'>🎚️ Upstream overloaded (%1), concurrency limit -> %2</font>",
+    "<font color='#FF9800'>🎚️ 上游过载 (%1)，并发限额降至 %2</font>"};
+const char *SV_LIMIT_STATUS[] = {
+    "<font color='#9E9E9E'>🎚️ Concurrency limit %1, in flight %2, queued %3</font>",
+    "<font color='#9E9E9E'>🎚️ 并发限额 %1，在途 %2，排队 %3</font>"};
+const char *SV_SHED_FULL[] = {
+    "<font color='#FF9800'>🚦 Overloaded: %1 requests pending, rejecting new ones (Retry-After %2 s)</font>",
+    "<font color='#FF9800'>🚦 服务过载：积压 %1 个请求，新请求直接拒绝 (Retry-After %2 秒)</font>"};
+const char *SV_SHED_BUDGET[] = {
+    "<font color='#FF9800'>🚦 Upstream queue delay %1 ms exceeds budget, rejecting new requests (Retry-After %2 s)</font>",
+    "<font color='#FF9800'>🚦 上游排队延迟 %1 ms 超出预算，新请求直接拒绝 (Retry-After %2 秒)</font>"};
+const char *SV_FAILOVER[] = {
+    "<font color='#FF9800'>🔀 Failing over to %1 (%2)</font>",
+    "<font color='#FF9800'>🔀 故障转移至 %1 (%2)</font>"};
+const char *SV_HEDGE_RESULT[] = {
+    "<font color='#888888'>[Debug] 🏁 Hedged after %1 ms to %2, hedge won: %3</font>",
+    "<font color='#888888'>[Debug] 🏁 等待 %1 ms 后对冲至 %2，对冲胜出：%3</font>"};
+const char *SV_KEYS_EXHAUSTED[] = {"Error: All API keys are cooling down or rate-limited", "错误：所有 API 密钥均处于冷却或限额中"};
+const char *SV_KEY_COOLDOWN[] = {
+    "<font color='#FF9800'>🔑 Key %1 rate-limited (429), cooling down</font>",
+    "<font color='#FF9800'>🔑 密钥 %1 被限流 (429)，进入冷却</font>"};
+const char *SV_KEY_QUARANTINE[] = {
+    "<font color='#F44336'>🔑 Key %1 rejected (%2), quarantined for 10 minutes</font>",
+    "<font color='#F44336'>🔑 密钥 %1 被拒绝 (%2)，隔离 10 分钟</font>"};
+const char *SV_NEGATIVE_ADDED[] = {
+    "<font color='#FF9800'>🚫 Text keeps failing, cooling down for %1 s</font>",
+    "<font color='#FF9800'>🚫 文本反复翻译失败，冷却 %1 秒后再试</font>"};
 
 struct EscapeMap
 {
@@ -51,22 +180,25 @@ struct EscapeMap
     int counter = 0;
 };
 
-// 冻结保护
-QString TranslationServer::freezeEscapesLocal(const QString &input, EscapeMap &context)
+// 冻结保护 (freezeNumerals 为 true 时额外把数字冻结为 [N_x] 槽位，用于模板化缓存键)
+QString TranslationServer::freezeEscapesLocal(const QString &input, EscapeMap &context, bool freezeNumerals)
 {
     QString result = input;
     context.map.clear();
     context.counter = 0;
     static const QRegularExpression regex(R"(\{\{.*?\}\}|<[^>]+>)");
+    // 标签/变量优先匹配，其内部的数字不会被当作槽位
+    static const QRegularExpression regexWithNumerals(R"(\{\{.*?\}\}|<[^>]+>|\d+(?:[.,]\d+)*)");
     int lastEnd = 0;
     QString newResult;
-    QRegularExpressionMatchIterator i = regex.globalMatch(result);
+    QRegularExpressionMatchIterator i = (freezeNumerals ? regexWithNumerals : regex).globalMatch(result);
     while (i.hasNext())
     {
         QRegularExpressionMatch match = i.next();
         newResult.append(result.mid(lastEnd, match.capturedStart() - lastEnd));
         QString original = match.captured(0);
-        QString tokenKey = QString("[T_%1]").arg(context.counter++);
+        const bool isNumeral = freezeNumerals && original.at(0).isDigit();
+        QString tokenKey = QString(isNumeral ? "[N_%1]" : "[T_%1]").arg(context.counter++);
         context.map[tokenKey] = original;
         newResult.append(tokenKey);
         lastEnd = match.capturedEnd();
@@ -243,27 +375,112 @@ TranslationServer::TranslationServer(QObject *parent) : QObject(parent), m_runni
 
 TranslationServer::~TranslationServer()
 {
-    stopServer();
+    // 析构时不再等待排空
+    stopServer(false);
     if (m_cleanupThread && m_cleanupThread->joinable())
     {
         m_cleanupThread->join();
         delete m_cleanupThread;
         m_cleanupThread = nullptr;
     }
+    stopCacheLoad();
+    stopWarmStart();
 }
 
 void TranslationServer::updateConfig(const AppConfig &config)
 {
-    std::lock_guard<std::mutex> keyLock(m_keyMutex);
     std::lock_guard<std::mutex> cfgLock(m_configMutex);
     m_config = config;
-    m_apiKeys.clear();
-    QStringList keys = m_config.api_key.split(',', Qt::SkipEmptyParts);
-    for (const auto &k : keys)
-        m_apiKeys.push_back(k.trimmed());
-    m_currentKeyIndex = 0;
+    m_keyScheduler.setKeys(m_config.api_key.split(',', Qt::SkipEmptyParts), m_config.perf.key_rpm_limit, m_config.perf.key_tpm_limit);
+    configureHedging();
     if (m_config.enable_glossary)
         GlossaryManager::instance().setFilePath(m_config.glossary_path);
+    m_glossaryEnabled = m_config.enable_glossary;
+
+    // 静态系统提示词预先转成 UTF-8，请求路径上不再逐次转换数 KB 的文本
+    m_basePromptUtf8 = std::make_shared<const std::string>(m_config.system_prompt.toStdString() + TRANSLATION_PROTOCOL);
+
+    // 预先计算配置指纹，避免每个请求都对数 KB 的提示词做哈希
+    QByteArray fp = m_config.model_name.toUtf8() + '\n' + m_config.system_prompt.toUtf8() + '\n' +
+                    m_config.pre_prompt.toUtf8() + '\n' + (m_config.enable_glossary ? "G1" : "G0");
+    m_configFingerprint = QString::fromLatin1(QCryptographicHash::hash(fp, QCryptographicHash::Md5).toHex().left(16));
+}
+
+void TranslationServer::configureHedging()
+{
+    // 调用方已持有 m_configMutex。每项为 "地址" 或 "地址|模型"；
+    // Key 与模型按地址从配置中读取 (与界面切换 API 地址时记忆的一致)，同地址换模型时沿用主 Key
+    QString primaryUrl = m_config.api_address.trimmed();
+    while (primaryUrl.endsWith('/'))
+        primaryUrl.chop(1);
+    std::vector<UpstreamHedging::Endpoint> endpoints;
+    QStringList backupSpecs;
+    for (const QString &entry : m_config.perf.hedge_api_urls)
+    {
+        UpstreamHedging::Endpoint ep;
+        ep.url = entry.section('|', 0, 0).trimmed();
+        while (ep.url.endsWith('/'))
+            ep.url.chop(1);
+        if (ep.url.isEmpty())
+            continue;
+        const bool samePrimary = ep.url.compare(primaryUrl, Qt::CaseInsensitive) == 0;
+        ep.model = entry.section('|', 1).trimmed();
+        if (ep.model.isEmpty())
+            ep.model = ConfigManager::loadModelForBaseUrl(ep.url);
+        if (ep.model.isEmpty())
+            ep.model = m_config.model_name;
+        const QStringList specs = samePrimary ? m_config.api_key.split(',', Qt::SkipEmptyParts)
+                                              : ConfigManager::loadApiKeyForBaseUrl(ep.url).split(',', Qt::SkipEmptyParts);
+        // 与主端点完全相同 (地址与模型都一样) 的对冲没有意义
+        if (samePrimary && ep.model == m_config.model_name)
+            continue;
+        // Key 可带 "@RPM/TPM" 限额后缀：发送时只用 Key 本体，限额交给调度器
+        for (const QString &spec : specs)
+        {
+            int rpm = 0, tpm = 0;
+            const QString key = ApiKeyScheduler::parseSpec(spec, rpm, tpm);
+            if (!key.isEmpty())
+                ep.keys << key;
+        }
+        if (!samePrimary)
+            backupSpecs << specs;
+        endpoints.push_back(ep);
+    }
+    m_backupKeys.setKeys(backupSpecs, m_config.perf.key_rpm_limit, m_config.perf.key_tpm_limit);
+    m_hedging.configure(endpoints, m_config.perf.hedge_min_delay_ms);
+}
+
+ApiKeyScheduler &TranslationServer::keySchedulerFor(const QString &key)
+{
+    return m_keyScheduler.contains(key) ? m_keyScheduler : m_backupKeys;
+}
+
+bool TranslationServer::acceptCompletion(const QByteArray &body, const SseCompletionStream *stream)
+{
+    std::string content;
+    if (stream && stream->sawEvents())
+    {
+        content = stream->content();
+    }
+    else
+    {
+        try
+        {
+            const json response = json::parse(body.constBegin(), body.constEnd());
+            const json &c = response.at("choices").at(0).at("message").at("content");
+            if (!c.is_string())
+                return false;
+            content = c.get<std::string>();
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+    static const QRegularExpression thinkTag(R"(<think(?:ing)?>.*?</think(?:ing)?>)", QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+    QString text = QString::fromUtf8(content.data(), static_cast<qsizetype>(content.size()));
+    text.remove(thinkTag);
+    return isValidTranslationResult(text.trimmed());
 }
 
 AppConfig TranslationServer::getConfig()
@@ -272,6 +489,58 @@ AppConfig TranslationServer::getConfig()
     return m_config;
 }
 
+void TranslationServer::startPipeline()
+{
+    // 上游调度器须先于 HTTP 服务 / 离线任务就绪；HTTP/1.1 连接总数受 upstream_max_connections 约束，
+    // 并在启动时预热到 API 主机的连接，首批请求无需再等握手
+    {
+        int workerThreads = 64;
+        int ioThreads = 2;
+        int maxConnections = 64;
+        QString apiAddress;
+        QStringList hedgeUrls;
+        {
+            std::lock_guard<std::mutex> lock(m_configMutex);
+            workerThreads = std::clamp(m_config.max_threads, 64, 256);
+            ioThreads = std::clamp(m_config.perf.upstream_io_threads, 1, 16);
+            maxConnections = std::clamp(m_config.perf.upstream_max_connections, 1, workerThreads);
+            apiAddress = m_config.api_address;
+            hedgeUrls = m_config.perf.hedge_api_urls;
+        }
+        m_upstream.start(ioThreads, (maxConnections + ioThreads - 1) / ioThreads);
+        m_upstream.prewarm(QUrl(apiAddress));
+        for (const QString &entry : hedgeUrls)
+            m_upstream.prewarm(QUrl(entry.section('|', 0, 0).trimmed()));
+    }
+
+    int lang = 1;
+    int threads = 64;
+    QString glossaryPath = "";
+    PerfConfig perf;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        lang = m_config.language;
+        threads = std::clamp(m_config.max_threads, 64, 256);
+        glossaryPath = m_config.glossary_path;
+        perf = m_config.perf;
+    }
+
+    if (perf.enable_cache)
+        startCacheLoad(perf.cache_path, static_cast<size_t>(std::max(1, perf.cache_budget_mb)) * 1024 * 1024, lang);
+
+    if (perf.warm_start && !glossaryPath.isEmpty())
+        startWarmStart(glossaryPath, lang);
+
+    m_limiter.configure(perf.adaptive_concurrency, 1, threads, perf.priority_aging_ms);
+    m_retryPolicy.configure(perf.retry_max_attempts, perf.retry_base_delay_ms, perf.retry_max_delay_ms, perf.retry_budget_ms);
+    m_microBatcher.configure(perf.custom_batch_window_ms, perf.custom_batch_max_chars, perf.custom_batch_max_items);
+
+    m_negativeCache.clearAll();
+    m_negativeCache.configure(perf.negative_ttl_sec, perf.negative_ttl_max_sec);
+    m_negativeEnabled = perf.negative_ttl_sec > 0;
+    m_negativeHits = 0;
+}
+
 void TranslationServer::startServer()
 {
     if (m_running || m_isStopping)
@@ -286,6 +555,8 @@ void TranslationServer::startServer()
 
     m_running = true;
     m_stopRequested = false;
+
+    startPipeline();
     m_serverThread = new std::thread(&TranslationServer::runServerLoop, this);
 
     int lang = 1;
@@ -321,13 +592,38 @@ void TranslationServer::startServer()
     emit serverStarted();
 }
 
-void TranslationServer::stopServer()
+void TranslationServer::stopServer(bool drain)
 {
-    if (!m_running || m_isStopping)
+    if (!m_running)
+        return;
+    if (m_isStopping)
+    {
+        // 排空期间再次停止：不再等待，立即转为强制中止
+        if (!m_stopRequested)
+        {
+            m_stopRequested = true;
+            m_upstream.abortAll();
+        }
         return;
+    }
+
+    int drainTimeoutMs = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        drainTimeoutMs = m_config.perf.drain_timeout_ms;
+    }
+    drain = drain && drainTimeoutMs > 0 && m_svr != nullptr;
 
-    m_stopRequested = true;
     m_isStopping = true;
+    if (drain)
+    {
+        m_draining = true;
+    }
+    else
+    {
+        m_stopRequested = true;
+        m_upstream.abortAll();
+    }
 
     if (m_cleanupThread && m_cleanupThread->joinable())
     {
@@ -336,11 +632,35 @@ void TranslationServer::stopServer()
         m_cleanupThread = nullptr;
     }
 
-    m_cleanupThread = new std::thread([this]()
+    m_cleanupThread = new std::thread([this, drain, drainTimeoutMs]()
                                       {
         QElapsedTimer stopTimer;
         stopTimer.start();
 
+        // 🛬 排空：进行中的请求 (已准入、尚未应答) 继续完成，成功的译文照常写入译文记忆；
+        // 超时或再次点击停止后退回强制中止
+        if (drain) {
+            int lang = 1;
+            {
+                std::lock_guard<std::mutex> lock(m_configMutex);
+                lang = m_config.language;
+            }
+            int pending = m_admission.stats().pending;
+            if (pending > 0) {
+                emit logMessage(QString(SV_DRAIN_START[lang]).arg(pending).arg(drainTimeoutMs));
+                while (pending > 0 && !m_stopRequested && stopTimer.elapsed() < drainTimeoutMs) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    pending = m_admission.stats().pending;
+                }
+                if (pending > 0)
+                    emit logMessage(QString(SV_DRAIN_TIMEOUT[lang]).arg(pending));
+                else
+                    emit logMessage(QString(SV_DRAIN_DONE[lang]).arg(stopTimer.elapsed()));
+            }
+            m_stopRequested = true;
+            m_upstream.abortAll();
+        }
+
         if (m_svr) {
             m_svr->stop(); // 此处配合异步泵，不会再卡死！
         }
@@ -353,6 +673,8 @@ void TranslationServer::stopServer()
 
         delete m_svr;
         m_svr = nullptr;
+        const std::map<QString, UpstreamDispatcher::HostStats> upstreamStats = m_upstream.hostStats();
+        m_upstream.stop();
 
         int lang = 1;
         int port = 6800;
@@ -366,6 +688,20 @@ void TranslationServer::stopServer()
             isDebug = m_config.enable_debug_mode;
         }
 
+        if (isDebug && m_cache.isOpen()) {
+            TranslationCache::Stats st = m_cache.stats();
+            emit logMessage(QString(SV_CACHE_STATS[lang]).arg(st.hits).arg(st.misses).arg(st.evictions).arg(st.entries)
+                                .arg(st.bytes / 1024).arg(st.budget / 1024));
+        }
+        if (isDebug) {
+            for (const auto &entry : upstreamStats)
+                emit logMessage(QString(SV_POOL_STATS[lang]).arg(entry.first).arg(entry.second.requests)
+                                    .arg(entry.second.handshakes).arg(entry.second.http2));
+        }
+        stopCacheLoad();
+        m_cache.close();
+        stopWarmStart();
+
         if (!glossaryPath.isEmpty()) {
             QString restoredFile = XuaConfigHijacker::autoDetectAndRestore(glossaryPath, port);
             if (!restoredFile.isEmpty()) {
@@ -385,6 +721,7 @@ void TranslationServer::stopServer()
         
         m_running = false;
         m_isStopping = false;
+        m_draining = false;
         emit serverStopped(); });
 }
 
@@ -392,29 +729,68 @@ void TranslationServer::runServerLoop()
 {
     m_svr = new httplib::Server();
 
-    int threads = 64;
     int port = 6800;
+    int httpMaxThreads = 1024;
+    int httpStackKb = 512;
     {
         std::lock_guard<std::mutex> lock(m_configMutex);
-        threads = std::clamp(m_config.max_threads, 64, 256);
         port = m_config.port;
+        httpMaxThreads = std::clamp(m_config.perf.http_max_threads, 16, 4096);
+        httpStackKb = std::clamp(m_config.perf.http_thread_stack_kb, 128, 8192);
+        m_admission.configure(m_config.perf.admission_max_pending, m_config.perf.admission_queue_budget_ms);
     }
 
-    m_svr->new_task_queue = [threads]
-    { return new httplib::ThreadPool(threads); };
+    // 🧵 连接处理线程：小栈、按需扩容、空闲回收，上限与上游并发脱钩 (上游并发由限流器控制)
+    m_httpPool.peak = 0;
+    m_httpPool.spawned = 0;
+    m_svr->new_task_queue = [this, httpMaxThreads, httpStackKb]
+    { return new ElasticTaskQueue(std::min(32, httpMaxThreads), httpMaxThreads, static_cast<size_t>(httpStackKb) * 1024, m_httpPool); };
+
+    // 🚦 过载卸载：被准入控制拒绝的请求立即以 503 + Retry-After 应答 (日志每 5 秒最多一条)
+    auto rejectOverloaded = [this](httplib::Response &res, AdmissionController::Verdict verdict, int retryAfterSec,
+                                   const char *body, const char *contentType)
+    {
+        res.status = 503;
+        res.set_header("Retry-After", std::to_string(retryAfterSec));
+        res.set_content(body, contentType);
+
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        qint64 last = m_lastShedLogMs.load();
+        if (now - last < 5000 || !m_lastShedLogMs.compare_exchange_strong(last, now))
+            return;
+        int langIdx = 1;
+        {
+            std::lock_guard<std::mutex> lock(m_configMutex);
+            langIdx = m_config.language;
+        }
+        const AdmissionController::Stats st = m_admission.stats();
+        if (verdict == AdmissionController::Verdict::QueueFull)
+            emit logMessage(QString(SV_SHED_FULL[langIdx]).arg(st.pending).arg(retryAfterSec));
+        else
+            emit logMessage(QString(SV_SHED_BUDGET[langIdx]).arg(st.queueDelayMs).arg(retryAfterSec));
+    };
 
     // ==========================================
     // Custom Handler
     // ==========================================
-    auto customHandler =   [this](const httplib::Request &req, httplib::Response &res)
+    auto customHandler =   [this, rejectOverloaded](const httplib::Request &req, httplib::Response &res)
     {
-        if (m_stopRequested.load(std::memory_order_relaxed))
+        if (m_stopRequested.load(std::memory_order_relaxed) || m_draining.load(std::memory_order_relaxed))
         {
             res.status = 503;
             res.set_content("Service Unavailable", "text/plain");
             return;
         }
 
+        AdmissionController::Verdict verdict = AdmissionController::Verdict::Admitted;
+        int retryAfterSec = 1;
+        const AdmissionController::Ticket admission = m_admission.admit(m_limiter.headWaitMs(), verdict, retryAfterSec);
+        if (!admission)
+        {
+            rejectOverloaded(res, verdict, retryAfterSec, "Server Busy", "text/plain");
+            return;
+        }
+
         if (!req.has_param("text"))
         {
             res.set_content("", "text/plain");
@@ -429,11 +805,15 @@ void TranslationServer::runServerLoop()
 
         int langIdx = 1;
         bool isDebug = false;
+        int clientTimeoutMs = 0;
         {
             std::lock_guard<std::mutex> lock(m_configMutex);
             langIdx = m_config.language;
             isDebug = m_config.enable_debug_mode;
+            clientTimeoutMs = m_config.perf.client_timeout_ms;
         }
+        // ⌛ 客户端愿意等待的时间：重试、对冲与每次上游尝试都必须落在其内；客户端断开连接时同样提前结束
+        const RequestDeadline deadline = RequestDeadline::after(clientTimeoutMs).withCancelProbe(req.is_connection_closed);
 
         text.replace("\r\n", "[LF]");
         text.replace("\n", "[LF]");
@@ -458,7 +838,7 @@ void TranslationServer::runServerLoop()
             return;
         }
 
-        QString result = performTranslation(text, QString::fromStdString(req.remote_addr));
+        QString result = translateCustomText(text, QString::fromStdString(req.remote_addr), deadline);
         
         // 🛑 如果处理期间点下了停止，阻止最终的输出！
         if (m_stopRequested.load(std::memory_order_relaxed))
@@ -483,7 +863,11 @@ void TranslationServer::runServerLoop()
         else
         {
             if (isDebug)
+            {
                 emit logMessage(QString("  -> %1 <span style='color:#FF4500; font-size:medium;'>[⏱️ %2 ms]</span>").arg(resultHtml).arg(elapsed));
+                const ConcurrencyLimiter::Stats ls = m_limiter.stats();
+                emit logMessage(QString(SV_LIMIT_STATUS[langIdx]).arg(ls.limit).arg(ls.inFlight).arg(ls.queued));
+            }
             else
                 emit logMessage(QString("  -> %1").arg(resultHtml));
             res.set_content(result.toStdString(), "text/plain; charset=utf-8");
@@ -496,15 +880,24 @@ void TranslationServer::runServerLoop()
     // ==========================================
     // Google Handler
     // ==========================================
-    auto googleHandler =  [this](const httplib::Request &req, httplib::Response &res)
+    auto googleHandler =  [this, rejectOverloaded](const httplib::Request &req, httplib::Response &res)
     {
-        if (m_stopRequested.load(std::memory_order_relaxed))
+        if (m_stopRequested.load(std::memory_order_relaxed) || m_draining.load(std::memory_order_relaxed))
         {
             res.status = 503;
             res.set_content("[]", "application/json");
             return;
         }
 
+        AdmissionController::Verdict verdict = AdmissionController::Verdict::Admitted;
+        int retryAfterSec = 1;
+        const AdmissionController::Ticket admission = m_admission.admit(m_limiter.headWaitMs(), verdict, retryAfterSec);
+        if (!admission)
+        {
+            rejectOverloaded(res, verdict, retryAfterSec, "[]", "application/json");
+            return;
+        }
+
         if (!req.has_param("q"))
         {
             res.set_content("[]", "application/json");
@@ -519,11 +912,15 @@ void TranslationServer::runServerLoop()
 
         int langIdx = 1;
         bool isDebug = false;
+        int clientTimeoutMs = 0;
         {
             std::lock_guard<std::mutex> lock(m_configMutex);
             langIdx = m_config.language;
             isDebug = m_config.enable_debug_mode;
+            clientTimeoutMs = m_config.perf.client_timeout_ms;
         }
+        // ⌛ 客户端愿意等待的时间：重试、对冲与每次上游尝试都必须落在其内；客户端断开连接时同样提前结束
+        const RequestDeadline deadline = RequestDeadline::after(clientTimeoutMs).withCancelProbe(req.is_connection_closed);
 
         emit workStarted();
         QElapsedTimer timer;
@@ -531,27 +928,77 @@ void TranslationServer::runServerLoop()
 
         QStringList allOrigLines = text.split('\n');
         std::vector<int> validIndices;
-        QStringList linesToTranslate;
 
         for (int i = 0; i < allOrigLines.size(); ++i)
         {
             QString line = allOrigLines[i].trimmed();
             if (containsTranslatableContent(line))
-            {
                 validIndices.push_back(i);
-                linesToTranslate.push_back(allOrigLines[i]);
-            }
         }
 
-        QString batchResultText;
-        if (linesToTranslate.isEmpty() || m_stopRequested.load(std::memory_order_relaxed))
+        // ==========================================
+        // 💾 逐行译文记忆拼接：命中的行直接回填，只把未命中的行 (去重后) 打包发给 LLM
+        // ==========================================
+        const bool useCache = m_cache.isOpen();
+        const QString cacheNs = cacheNamespace();
+        QStringList lineResults;            // 与 allOrigLines 一一对应，空串表示保留原文
+        for (int i = 0; i < allOrigLines.size(); ++i)
+            lineResults.push_back(QString());
+        QStringList missLines;              // 未命中的行 (去重)
+        QHash<QString, int> missIndexOf;
+        std::vector<int> lineToMiss(allOrigLines.size(), -1);
+        int cacheHitLines = 0;
+
+        for (int i : validIndices)
         {
-            batchResultText = "";
+            const QString &line = allOrigLines[i];
+            QString remembered;
+            if (lookupMemory(cacheNs, line, remembered))
+            {
+                lineResults[i] = remembered;
+                cacheHitLines++;
+                continue;
+            }
+            auto it = missIndexOf.constFind(line);
+            if (it == missIndexOf.constEnd())
+            {
+                it = missIndexOf.insert(line, missLines.size());
+                missLines.push_back(line);
+            }
+            lineToMiss[i] = it.value();
         }
-        else
+
+        QString batchResultText;
+        if (!missLines.isEmpty() && !m_stopRequested.load(std::memory_order_relaxed))
         {
-            QString cleanPayload = linesToTranslate.join('\n');
-            batchResultText = performTranslation(cleanPayload, QString::fromStdString(req.remote_addr));
+            QString cleanPayload = missLines.join('\n');
+            // ⚖️ 优先级：少量短行 (对话框、按钮) 算短批次，整屏界面文本算长批次，都让位于 [Custom] 单条对话
+            const ConcurrencyLimiter::Priority priority = (missLines.size() <= SHORT_BATCH_MAX_LINES && cleanPayload.size() <= SHORT_BATCH_MAX_CHARS)
+                                                              ? ConcurrencyLimiter::Priority::ShortBatch
+                                                              : ConcurrencyLimiter::Priority::LongBatch;
+            // 拼接后的未命中载荷几乎不会原样重现，不整条写入记忆，只做下面的逐行写回
+            batchResultText = performTranslation(cleanPayload, QString::fromStdString(req.remote_addr), deadline, priority, false);
+
+            QStringList translatedLines;
+            if (!batchResultText.isEmpty())
+                translatedLines = batchResultText.split('\n');
+
+            for (int i : validIndices)
+            {
+                int missIdx = lineToMiss[i];
+                if (missIdx >= 0 && missIdx < translatedLines.size())
+                    lineResults[i] = translatedLines[missIdx];
+            }
+
+            // 行数对齐时才逐行写回记忆，防止错位译文污染缓存
+            if (useCache && translatedLines.size() == missLines.size())
+            {
+                for (int m = 0; m < missLines.size(); ++m)
+                {
+                    if (!translatedLines[m].trimmed().isEmpty())
+                        rememberTranslation(cacheNs, missLines[m], translatedLines[m]);
+                }
+            }
         }
 
         // 🛑 如果已请求停止服务，直接截断！防止批处理排队导致的 UI 日志狂乱输出（ANR）
@@ -564,52 +1011,17 @@ void TranslationServer::runServerLoop()
         }
 
         qint64 elapsed = timer.elapsed();
-        emit workFinished(!batchResultText.isEmpty() && !m_stopRequested);
-
-        QStringList translatedLines;
-        if (!batchResultText.isEmpty())
-        {
-            translatedLines = batchResultText.split('\n');
-        }
+        bool batchOk = missLines.isEmpty() ? (cacheHitLines > 0) : !batchResultText.isEmpty();
+        emit workFinished(batchOk && !m_stopRequested);
 
         QStringList finalOutputLines;
-        int transIdx = 0;
 
         QString prefix = QString("<b style='color:#FF9800'>[Google]</b> ") + QString(SV_LOG_REQ_PREFIX[langIdx]);
 
         for (int i = 0; i < allOrigLines.size(); ++i)
         {
-            bool isValid = false;
-            for (int valIdx : validIndices)
-            {
-                if (valIdx == i)
-                {
-                    isValid = true;
-                    break;
-                }
-            }
-
             QString origL = allOrigLines[i];
-            QString finalL;
-
-            if (!isValid)
-            {
-                finalL = origL;
-            }
-            else
-            {
-                if (transIdx < translatedLines.size())
-                {
-                    finalL = translatedLines[transIdx];
-                    if (finalL.isEmpty())
-                        finalL = origL;
-                }
-                else
-                {
-                    finalL = origL;
-                }
-                transIdx++;
-            }
+            QString finalL = lineResults[i].isEmpty() ? origL : lineResults[i];
 
             QString origHtml = unityToHtml(origL);
             if (isDebug)
@@ -620,8 +1032,8 @@ void TranslationServer::runServerLoop()
             QString finalHtml = unityToHtml(finalL);
             if (isDebug && i == allOrigLines.size() - 1)
             {
-                QString timingStr = (langIdx == 0) ? QString(" <span style='color:#FF00FF; font-size:medium;'>[📦 Batch Total: %1 ms]</span>").arg(elapsed)
-                                                   : QString(" <span style='color:#FF00FF; font-size:medium;'>[📦 包总耗时: %1 ms]</span>").arg(elapsed);
+                QString timingStr = (langIdx == 0) ? QString(" <span style='color:#FF00FF; font-size:medium;'>[📦 Batch Total: %1 ms, 💾 %2/%3 cached]</span>").arg(elapsed).arg(cacheHitLines).arg(validIndices.size())
+                                                   : QString(" <span style='color:#FF00FF; font-size:medium;'>[📦 包总耗时: %1 ms，💾 记忆命中 %2/%3 行]</span>").arg(elapsed).arg(cacheHitLines).arg(validIndices.size());
                 emit logMessage("  -> " + finalHtml + timingStr);
             }
             else
@@ -645,7 +1057,22 @@ void TranslationServer::runServerLoop()
     m_svr->Get("/translate_a/single", googleHandler);
     m_svr->Post("/translate_a/single", googleHandler);
 
-    m_svr->listen("0.0.0.0", port);
+    // ==========================================
+    // 📊 运行统计 (用于在低配机器上调整缓存预算等参数)
+    // ==========================================
+    m_svr->Get("/stats", [this](const httplib::Request &, httplib::Response &res)
+               { res.set_content(collectStats().dump(2), "application/json; charset=utf-8"); });
+
+    if (!m_svr->listen("0.0.0.0", port) && !m_stopRequested)
+    {
+        int lang = 1;
+        {
+            std::lock_guard<std::mutex> lock(m_configMutex);
+            lang = m_config.language;
+        }
+        emit logMessage(QString(SV_ERR_LISTEN[lang]).arg(port));
+        emit listenFailed(port);
+    }
 }
 
 bool TranslationServer::containsTranslatableContent(const QString &text)
@@ -654,39 +1081,365 @@ bool TranslationServer::containsTranslatableContent(const QString &text)
     return text.contains(hasLetter);
 }
 
-QString TranslationServer::performTranslation(const QString &text, const QString &clientIP)
+QString TranslationServer::performTranslation(const QString &text, const QString &clientIP, const RequestDeadline &deadline,
+                                              ConcurrencyLimiter::Priority priority, bool remember)
 {
     if (!containsTranslatableContent(text))
         return text;
 
+    int langIdx = 1;
+    bool isDebug = false;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        langIdx = m_config.language;
+        isDebug = m_config.enable_debug_mode;
+    }
+
+    // 💾 译文记忆 / 热启动索引：命中则跳过冻结、术语、LLM 往返与修复的整条链路
+    const bool useCache = m_cache.isOpen();
+    const QString cacheNs = cacheNamespace();
+    const std::string cacheKey = TranslationCache::makeKey(cacheNs, text);
+    {
+        QString remembered;
+        bool fromTemplate = false;
+        if (lookupMemory(cacheNs, text, remembered, &fromTemplate))
+        {
+            if (isDebug)
+                emit logMessage(fromTemplate ? SV_TEMPLATE_HIT[langIdx] : SV_CACHE_HIT[langIdx]);
+            return remembered;
+        }
+    }
+
+    // 🚫 负缓存：冷却期内的已知失败文本直接返回失败，不再跑满整轮重试
+    if (m_negativeEnabled.load(std::memory_order_relaxed))
+    {
+        int remainingSec = 0;
+        if (m_negativeCache.isBlocked(cacheKey, remainingSec))
+        {
+            m_negativeHits++;
+            if (isDebug)
+                emit logMessage(QString(SV_NEGATIVE_HIT[langIdx]).arg(remainingSec));
+            return "";
+        }
+    }
+
+    // 🛬 单飞合并：同一文本已有请求在飞时，挂在它的结果上而不是再发一次 LLM
+    std::shared_ptr<InFlightTranslation> flight;
+    bool isLeader = false;
+    {
+        std::lock_guard<std::mutex> lock(m_inFlightMutex);
+        auto it = m_inFlight.find(cacheKey);
+        if (it != m_inFlight.end())
+        {
+            // 在表锁内登记：发起者看到 waiters == 0 时，不会有刚找到表项、尚未登记的跟随者
+            flight = it->second;
+            flight->waiters++;
+        }
+        else
+        {
+            flight = std::make_shared<InFlightTranslation>();
+            m_inFlight.emplace(cacheKey, flight);
+            isLeader = true;
+        }
+    }
+
+    if (!isLeader)
+    {
+        std::unique_lock<std::mutex> lock(flight->mutex);
+        while (!flight->done)
+        {
+            if (m_stopRequested.load(std::memory_order_relaxed) || deadline.abandoned())
+            {
+                flight->waiters--;
+                return "";
+            }
+            flight->cv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        flight->waiters--;
+        if (flight->abandoned && !deadline.abandoned())
+        {
+            // 发起者提前离开，本请求还没到期：重新走一遍 (第一个重试者成为新的发起者)
+            lock.unlock();
+            return performTranslation(text, clientIP, deadline, priority, remember);
+        }
+        if (isDebug)
+            emit logMessage(SV_COALESCED[langIdx]);
+        return flight->result;
+    }
+
+    // 发起者的客户端断开时，只要还有跟随者在等，上游调用就继续 (结果照常写入译文记忆)
+    RequestDeadline upstreamDeadline = deadline;
+    if (deadline.cancellable())
+        upstreamDeadline = deadline.withCancelProbe([deadline, flight]()
+                                                    { return flight->waiters.load() == 0 && deadline.cancelled(); });
+
+    AttemptFailure lastFailure = AttemptFailure::None;
+    QString resultText = performUpstreamTranslation(text, clientIP, upstreamDeadline, priority, &lastFailure);
+
+    if (useCache && remember && !resultText.isEmpty())
+        rememberTranslation(cacheNs, text, resultText);
+
+    if (m_negativeEnabled.load(std::memory_order_relaxed))
+    {
+        if (!resultText.isEmpty())
+        {
+            m_negativeCache.clear(cacheKey);
+        }
+        else if (lastFailure == AttemptFailure::BadResponse || lastFailure == AttemptFailure::Rejected)
+        {
+            const int ttl = m_negativeCache.recordFailure(cacheKey);
+            emit logMessage(QString(SV_NEGATIVE_ADDED[langIdx]).arg(ttl));
+        }
+    }
+
+    // 先摘除表项再唤醒：之后到达的同文本请求将直接命中缓存或开启新一轮
+    {
+        std::lock_guard<std::mutex> lock(m_inFlightMutex);
+        m_inFlight.erase(cacheKey);
+    }
+    {
+        std::lock_guard<std::mutex> lock(flight->mutex);
+        flight->result = resultText;
+        flight->abandoned = resultText.isEmpty() && deadline.abandoned() && !m_stopRequested.load(std::memory_order_relaxed);
+        flight->done = true;
+    }
+    flight->cv.notify_all();
+
+    return resultText;
+}
+
+QString TranslationServer::translateCustomText(const QString &text, const QString &clientIP, const RequestDeadline &deadline)
+{
+    if (!m_microBatcher.enabled() || !containsTranslatableContent(text))
+        return performTranslation(text, clientIP, deadline, ConcurrencyLimiter::Priority::Dialogue);
+
+    // 记忆命中与负缓存直接走单条流程，只有真正需要上游的文本才进入批次
+    const QString cacheNs = cacheNamespace();
+    QString remembered;
+    if (lookupMemory(cacheNs, text, remembered))
+        return performTranslation(text, clientIP, deadline, ConcurrencyLimiter::Priority::Dialogue);
+    int remainingSec = 0;
+    if (m_negativeEnabled.load(std::memory_order_relaxed) &&
+        m_negativeCache.isBlocked(TranslationCache::makeKey(cacheNs, text), remainingSec))
+        return performTranslation(text, clientIP, deadline, ConcurrencyLimiter::Priority::Dialogue);
+
+    // 批次由组长按自己的截止时间执行 (组长最先到达，截止时间也最早)；
+    // 批内还有其他客户端的文本，只有批内所有客户端都已断开时才取消上游调用
+    QString result;
+    const bool batched = m_microBatcher.submit(
+        text, result, [this, &deadline]()
+        { return m_stopRequested.load(std::memory_order_relaxed) || deadline.abandoned(); },
+        [this, &deadline]()
+        { return m_stopRequested.load(std::memory_order_relaxed) || deadline.expired(); },
+        [this, clientIP, &deadline](const QStringList &texts, const std::function<bool()> &allGone)
+        { return runCustomBatch(texts, clientIP, deadline.withCancelProbe(deadline.cancellable() ? allGone : nullptr)); });
+    if (batched)
+        return result;
+    if (m_stopRequested.load(std::memory_order_relaxed) || deadline.abandoned())
+        return "";
+    return performTranslation(text, clientIP, deadline, ConcurrencyLimiter::Priority::Dialogue);
+}
+
+std::vector<std::optional<QString>> TranslationServer::runCustomBatch(const QStringList &texts, const QString &clientIP, const RequestDeadline &deadline,
+                                                                    ConcurrencyLimiter::Priority priority)
+{
+    std::vector<std::optional<QString>> results(texts.size());
+    if (texts.size() == 1)
+    {
+        results[0] = performTranslation(texts[0], clientIP, deadline, priority);
+        return results;
+    }
+
+    int langIdx = 1;
+    bool isDebug = false;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        langIdx = m_config.language;
+        isDebug = m_config.enable_debug_mode;
+    }
+
+    // 每行加 [#n] 编号，LLM 漏行或合并行时仍可按编号对位
+    QStringList numbered;
+    for (int i = 0; i < texts.size(); ++i)
+        numbered << QString("[#%1] %2").arg(i + 1).arg(texts[i]);
+    const QString batchText = performUpstreamTranslation(numbered.join('\n'), clientIP, deadline, priority, nullptr, true);
+    if (batchText.isEmpty())
+        return results; // 整批失败：全部退回单条翻译
+
+    static const QRegularExpression markerRegex(R"(^\s*\[#(\d+)\]\s*)");
+    const QStringList lines = batchText.split('\n', Qt::SkipEmptyParts);
+    QStringList byMarker;
+    for (int i = 0; i < texts.size(); ++i)
+        byMarker << QString();
+    int marked = 0;
+    for (const QString &line : lines)
+    {
+        QRegularExpressionMatch m = markerRegex.match(line);
+        if (!m.hasMatch())
+            continue;
+        const int idx = m.captured(1).toInt() - 1;
+        const QString body = line.mid(m.capturedLength()).trimmed();
+        if (idx >= 0 && idx < texts.size() && byMarker[idx].isEmpty() && !body.isEmpty())
+        {
+            byMarker[idx] = body;
+            marked++;
+        }
+    }
+
+    // 编号全部丢失但行数一致时，按顺序对位
+    if (marked == 0 && lines.size() == texts.size())
+    {
+        for (int i = 0; i < texts.size(); ++i)
+            byMarker[i] = lines[i].trimmed();
+    }
+
+    const bool useCache = m_cache.isOpen();
+    const QString cacheNs = cacheNamespace();
+    int routed = 0;
+    for (int i = 0; i < texts.size(); ++i)
+    {
+        if (byMarker[i].isEmpty() || !isValidTranslationResult(byMarker[i]))
+            continue;
+        results[i] = byMarker[i];
+        routed++;
+        if (useCache)
+            rememberTranslation(cacheNs, texts[i], byMarker[i]);
+    }
+    if (isDebug)
+        emit logMessage(QString(SV_MICRO_BATCH[langIdx]).arg(texts.size()).arg(routed));
+    return results;
+}
+
+void TranslationServer::startOffline()
+{
+    if (m_running || m_isStopping)
+        return;
+    m_running = true;
+    m_stopRequested = false;
+    startPipeline();
+    // 命令行下没有需要保持响应的界面：等译文记忆加载完再开始，批量任务才能充分命中
+    if (m_cacheThread && m_cacheThread->joinable())
+    {
+        m_cacheThread->join();
+        delete m_cacheThread;
+        m_cacheThread = nullptr;
+    }
+}
+
+void TranslationServer::stopOffline()
+{
+    // 在线服务走 stopServer 的完整收尾流程
+    if (!m_running || m_serverThread)
+        return;
+    m_stopRequested = true;
+    m_upstream.stop();
+    stopCacheLoad();
+    m_cache.close();
+    stopWarmStart();
+    m_running = false;
+}
+
+QStringList TranslationServer::translateOffline(const QStringList &texts)
+{
+    // 离线预翻译各条文本互不相关，并行的批次也不应共享同一份上下文：一律不带上下文历史
+    const QString clientIP;
+    QStringList results;
+    for (int i = 0; i < texts.size(); ++i)
+        results << QString();
+
+    // 记忆命中、无需翻译与多行的文本直接走单条流程 (多行文本无法按行编号对位)
+    const QString cacheNs = cacheNamespace();
+    QStringList pending;
+    std::vector<int> pendingIndex;
+    for (int i = 0; i < texts.size(); ++i)
+    {
+        QString remembered;
+        if (!containsTranslatableContent(texts[i]) || texts[i].contains('\n') || lookupMemory(cacheNs, texts[i], remembered))
+            continue;
+        pending << texts[i];
+        pendingIndex.push_back(i);
+    }
+    if (pending.size() > 1)
+    {
+        const std::vector<std::optional<QString>> batched = runCustomBatch(pending, clientIP, RequestDeadline(), ConcurrencyLimiter::Priority::LongBatch);
+        for (size_t k = 0; k < batched.size(); ++k)
+        {
+            if (batched[k])
+                results[pendingIndex[k]] = *batched[k];
+        }
+    }
+
+    for (int i = 0; i < texts.size(); ++i)
+    {
+        if (m_stopRequested.load(std::memory_order_relaxed))
+            break;
+        if (results[i].isEmpty())
+            results[i] = performTranslation(texts[i], clientIP, RequestDeadline(), ConcurrencyLimiter::Priority::LongBatch);
+    }
+    return results;
+}
+
+QString TranslationServer::performUpstreamTranslation(const QString &text, const QString &clientIP, const RequestDeadline &deadline,
+                                                      ConcurrencyLimiter::Priority priority, AttemptFailure *lastFailure, bool numberedBatch)
+{
     QString resultText = "";
     int retryCount = 0;
-    const int MAX_RETRY_COUNT = 5;
-    const int RETRY_DELAY_MS = 1000;
+    // 下一次尝试前的等待 (由重试策略按失败类型给出)
+    qint64 retryDelayMs = 0;
+    // 上一次尝试遇到硬错误且配置了备用端点：本次直接故障转移，不再等待
+    bool failover = false;
     int langIdx = 1;
     {
         std::lock_guard<std::mutex> lock(m_configMutex);
         langIdx = m_config.language;
     }
+    QElapsedTimer requestTimer;
+    requestTimer.start();
+    // 客户端断开与超时分别记录
+    auto logAbandoned = [this, &deadline, langIdx]()
+    {
+        if (deadline.cancelled())
+        {
+            m_clientGone++;
+            emit logMessage(SV_CLIENT_GONE[langIdx]);
+        }
+        else
+        {
+            emit logMessage(SV_DEADLINE_EXCEEDED[langIdx]);
+        }
+    };
 
-    while (retryCount < MAX_RETRY_COUNT)
+    for (;;)
     {
         if (m_stopRequested)
         {
             emit logMessage(SV_ABORTED[langIdx]);
             return "";
         }
+        if (deadline.abandoned())
+        {
+            logAbandoned();
+            return "";
+        }
         if (retryCount > 0)
         {
-            emit logMessage(QString(SV_RETRY_ATTEMPT[langIdx]).arg(retryCount + 1).arg(MAX_RETRY_COUNT));
-            for (int i = 0; i < RETRY_DELAY_MS / 100; ++i)
+            emit logMessage(QString(SV_RETRY_ATTEMPT[langIdx]).arg(retryCount + 1).arg(m_retryPolicy.maxAttempts()));
+            for (qint64 waited = 0; waited < retryDelayMs; waited += 100)
             {
                 if (m_stopRequested)
                     return "";
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if (deadline.abandoned())
+                {
+                    logAbandoned();
+                    return "";
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(std::min<qint64>(100, retryDelayMs - waited)));
             }
         }
-        QString attemptResult = performSingleTranslationAttempt(text, clientIP);
+        AttemptOutcome outcome;
+        QString attemptResult = performSingleTranslationAttempt(text, clientIP, deadline, priority, outcome, failover, numberedBatch);
+        if (lastFailure)
+            *lastFailure = outcome.failure;
         if (m_stopRequested)
             return "";
         if (isValidTranslationResult(attemptResult))
@@ -696,11 +1449,27 @@ QString TranslationServer::performTranslation(const QString &text, const QString
             resultText = attemptResult;
             break;
         }
+        const AttemptFailure failure = outcome.failure;
+        failover = (failure == AttemptFailure::Network || failure == AttemptFailure::Timeout || failure == AttemptFailure::Throttled ||
+                    failure == AttemptFailure::RateLimited || failure == AttemptFailure::ServerError) &&
+                   m_hedging.enabled();
         retryCount++;
-        if (retryCount >= MAX_RETRY_COUNT)
+        retryDelayMs = m_retryPolicy.nextDelayMs(outcome, retryCount, requestTimer.elapsed(), failover);
+        // 客户端已经放弃 (超时或断开)，或等待结束时才会放弃，就不必再试
+        if (deadline.abandoned() || (retryDelayMs >= 0 && retryDelayMs >= deadline.remainingMs()))
         {
-            emit logMessage(SV_RETRY_FAILED[langIdx]);
+            logAbandoned();
             resultText = "";
+            break;
+        }
+        if (retryDelayMs < 0)
+        {
+            if (failure == AttemptFailure::ClientError)
+                emit logMessage(QString(SV_RETRY_GIVE_UP[langIdx]).arg(outcome.httpStatus));
+            else if (failure != AttemptFailure::Aborted)
+                emit logMessage(SV_RETRY_FAILED[langIdx]);
+            resultText = "";
+            break;
         }
     }
     return resultText;
@@ -716,10 +1485,17 @@ bool TranslationServer::isValidTranslationResult(const QString &result)
 }
 
 // 🔥 终极单次请求翻译尝试：完美结合碎片化标签重组与内存防泄漏机制
-QString TranslationServer::performSingleTranslationAttempt(const QString &text, const QString &clientIP)
+QString TranslationServer::performSingleTranslationAttempt(const QString &text, const QString &clientIP, const RequestDeadline &deadline,
+                                                           ConcurrencyLimiter::Priority priority, AttemptOutcome &outcome, bool failover,
+                                                           bool numberedBatch)
 {
+    AttemptFailure &failure = outcome.failure;
+    failure = AttemptFailure::None;
     if (m_stopRequested.load(std::memory_order_relaxed))
+    {
+        failure = AttemptFailure::Aborted;
         return "";
+    }
 
     // ==========================================
     // 🛠️ 预处理：物理粉碎干扰 LLM 翻译的碎片化标签 (<rotate>, <voffset>)
@@ -729,7 +1505,7 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
     bool hasRotate = false;
     QString rotateOpenTag = "";
     
-    QRegularExpression rotFinder(R"(<rotate\s*\\?=\s*[^>]+>|<rotate>)", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression rotFinder(R"(<rotate\s*\\?=\s*[^>]+>|<rotate>)", QRegularExpression::CaseInsensitiveOption);
     QRegularExpressionMatch rotMatch = rotFinder.match(preText);
     if(rotMatch.hasMatch()) {
         hasRotate = true;
@@ -737,19 +1513,23 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
     }
 
     // 无情抹除这些把字拆散的罪魁祸首
-    preText.remove(QRegularExpression(R"(</?rotate[^>]*>)", QRegularExpression::CaseInsensitiveOption));
-    preText.remove(QRegularExpression(R"(</?voffset[^>]*>)", QRegularExpression::CaseInsensitiveOption));
+    static const QRegularExpression rotateTag(R"(</?rotate[^>]*>)", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression voffsetTag(R"(</?voffset[^>]*>)", QRegularExpression::CaseInsensitiveOption);
+    preText.remove(rotateTag);
+    preText.remove(voffsetTag);
 
     AppConfig cfg;
+    std::shared_ptr<const std::string> basePrompt;
     {
         std::lock_guard<std::mutex> lock(m_configMutex);
         cfg = m_config;
+        basePrompt = m_basePromptUtf8;
     }
 
-    QString apiKey = getNextApiKey();
-    if (apiKey.isEmpty())
+    if (!m_keyScheduler.hasKeys())
     {
         emit logMessage("<font color='#F44336'>❌ " + QString(SV_ERR_KEY[cfg.language]) + "</font>");
+        failure = AttemptFailure::NoApiKey;
         return "";
     }
 
@@ -759,41 +1539,27 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
     if (cfg.enable_glossary)
         processedText = RegexManager::instance().processPre(processedText);
     std::string clientId = generateClientId(clientIP.toStdString()).toStdString();
+    // 编号批次不读写上下文历史：历史中混入整批编号文本会撑大后续提示词，并诱导单条译文也带上 [#n]；
+    // clientIP 为空 (离线预翻译) 同样不带上下文
+    const bool useHistory = !numberedBatch && !clientIP.isEmpty();
 
-    QString finalSystemPrompt = cfg.system_prompt;
+    // 系统提示词直接以 UTF-8 组装：静态部分 (用户提示词 + 翻译协议) 已在配置更新时转换好，
+    // 这里只追加随请求变化的段落
+    std::string finalSystemPrompt = basePrompt ? *basePrompt : std::string();
     bool performExtraction = false;
-
-    finalSystemPrompt += "\n\n【Translation Protocol (STRICT)】:\n"
-                         "0. 🛡️ PRIORITY: TAGS/VARS/Z-CODES > GRAMMAR > STYLE. Never break code structures.\n"
-                         "1. 📤 OUTPUT: Return ONLY the translated result. NO explanations. NO markdown.\n"
-                         "2. 🧱 IMMUTABLES (KEEP EXACTLY):\n"
-                         "   - [T_0], [T_1] ... : Placeholder tokens.\n"
-                         "   - [LF] : Line break.\n"
-                         "   - {{A}}, {{B}} ... : Variables. NEVER translate letters inside.\n"
-                         "3. 📦 CONTAINERS (TRANSLATE CONTENT, KEEP WRAPPERS):\n"
-                         "   - Z-Codes: 'Z[A-Z]{2}Z ... Z[A-Z]{2}Z'. Keep markers, translate inside.\n"
-                         "   - HTML: '<tag>text</tag>'. Keep tags, translate 'text'.\n"
-                         "4. 💬 PUNCTUATION & FORMAT:\n"
-                         "   - Convert punctuation in visible text ONLY.\n"
-                         "   - Do NOT modify punctuation inside tags.\n"
-                         "   - Preserve spacing around tags.\n"
-                         "5. 🧠 TRANSLATION LOGIC:\n"
-                         "   - Treat input as independent UI fragments.\n"
-                         "6. 🚫 ANTI-HALLUCINATION (CRITICAL):\n"
-                         "   - DO NOT add <size>, <color>, <b>, <i> or brackets like [size=...] if they are not in the input.\n"
-                         "   - DO NOT try to fix or close tags. Just keep exactly what you see.\n"
-                         "   - DO NOT invent speaker names. DO NOT output </T_0>.\n"
-                         "7. 🚨 FINAL SAFETY CHECK:\n"
-                         "   - All tags closed\n"
-                         "   - All {{X}} preserved\n"
-                         "   - No new Z-codes created\n";
+    // 新术语只从足够长的文本中提取
+    const bool allowNewTerms = text.length() > 5;
+    // ⚡ 提示词缓存友好布局：系统提示词只含由配置决定的静态内容，逐字节稳定，
+    // 每次变化的术语上下文移到用户消息中，让上游的前缀缓存覆盖整个系统提示词
+    const bool cacheLayout = cfg.perf.prompt_cache_layout;
+    QString glossaryContext;
 
     if (cfg.enable_glossary)
     {
-        QString glossaryContext = GlossaryManager::instance().getContextPrompt(processedText);
-        if (!glossaryContext.isEmpty())
-            finalSystemPrompt += "\n" + glossaryContext;
-        if (text.length() > 5)
+        glossaryContext = GlossaryManager::instance().getContextPrompt(processedText);
+        if (!glossaryContext.isEmpty() && !cacheLayout)
+            finalSystemPrompt += "\n" + glossaryContext.toStdString();
+        if (allowNewTerms || cacheLayout)
         {
             performExtraction = true;
             finalSystemPrompt += "\n【Term Extraction】:\n"
@@ -803,9 +1569,24 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
         }
     }
 
+    const QString apiHost = QUrl(cfg.api_address).host().toLower();
+    // 支持显式 cache_control 内容块的上游 (OpenRouter / Anthropic 兼容端点)
+    const bool cacheControlHints = cacheLayout &&
+                                   (apiHost.contains("openrouter") || apiHost.contains("anthropic") ||
+                                    cfg.model_name.contains("claude", Qt::CaseInsensitive));
+
     json messages = json::array();
-    messages.push_back({{"role", "system"}, {"content", finalSystemPrompt.toStdString()}});
+    if (cacheControlHints)
+    {
+        json systemPart = {{"type", "text"}, {"text", std::move(finalSystemPrompt)}, {"cache_control", {{"type", "ephemeral"}}}};
+        messages.push_back({{"role", "system"}, {"content", json::array({systemPart})}});
+    }
+    else
+    {
+        messages.push_back({{"role", "system"}, {"content", std::move(finalSystemPrompt)}});
+    }
 
+    if (useHistory)
     {
         std::lock_guard<std::mutex> lock(m_contextMutex);
         Context &ctx = m_contexts[clientId];
@@ -813,91 +1594,304 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
             ctx.max_len = cfg.context_num;
         for (const auto &pair : ctx.history)
         {
-            messages.push_back({{"role", "user"}, {"content", pair.first.toStdString()}});
-            messages.push_back({{"role", "assistant"}, {"content", pair.second.toStdString()}});
+            messages.push_back({{"role", "user"}, {"content", pair.first}});
+            messages.push_back({{"role", "assistant"}, {"content", pair.second}});
         }
     }
 
-    QString currentUserContent = cfg.pre_prompt + processedText;
-    messages.push_back({{"role", "user"}, {"content", currentUserContent.toStdString()}});
+    // 本轮用户消息只转换一次，发送与写入历史共用
+    const std::string currentUserContent = (numberedBatch ? std::string(BATCH_PROTOCOL) : std::string()) +
+                                           (cfg.pre_prompt + processedText).toStdString();
+    // 缓存布局下术语上下文只随本次用户消息发送，历史记录中不保存
+    if (cacheLayout && !glossaryContext.isEmpty())
+        messages.push_back({{"role", "user"}, {"content", glossaryContext.toStdString() + "\n" + currentUserContent}});
+    else
+        messages.push_back({{"role", "user"}, {"content", currentUserContent}});
 
     json payload;
     payload["model"] = cfg.model_name.toStdString();
     payload["messages"] = messages;
     payload["temperature"] = cfg.temperature;
+    // OpenAI 官方接口：相同前缀的请求路由到同一缓存分片
+    if (cacheLayout && apiHost == "api.openai.com")
+    {
+        QString configFp;
+        {
+            std::lock_guard<std::mutex> lock(m_configMutex);
+            configFp = m_configFingerprint;
+        }
+        payload["prompt_cache_key"] = ("xunity-" + configFp).toStdString();
+    }
 
-    // ==========================================
-    // 🛠️ 特性 1：底层网络解耦 & 内存回收确认 (Modern C++ RAII)
-    // ==========================================
-    static thread_local std::unique_ptr<QNetworkAccessManager> threadNam;
-    if (!threadNam)
-        threadNam = std::make_unique<QNetworkAccessManager>();
+    // 🌊 流式应答：边收边检测，译文明显失控时立即中止，不再空等到超时
+    // (对冲时每条支路各有一个解析器，最终采用胜出一方的)
+    std::set<std::string> sourceZCodes;
+    if (cfg.perf.stream_upstream)
+    {
+        payload["stream"] = true;
+        payload["stream_options"] = {{"include_usage", true}};
+        static const QRegularExpression zCodeRegex("Z[A-Z]{2}Z");
+        QRegularExpressionMatchIterator zit = zCodeRegex.globalMatch(processedText);
+        while (zit.hasNext())
+            sourceZCodes.insert(zit.next().captured().toStdString());
+    }
+    // 🏁 对冲：主端点超过其 p90 延迟仍未应答时，向备用端点补发一份副本 (故障转移时不对冲)
+    qint64 hedgeDelay = -1;
+    auto makeLeg = [&](const QString &apiAddress, const QString &apiKey, const QByteArray &legBody, std::shared_ptr<SseCompletionStream> &legStream)
+    {
+        UpstreamDispatcher::Leg leg;
+        leg.request = QNetworkRequest(QUrl(apiAddress + "/chat/completions"));
+        leg.request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+        leg.request.setRawHeader("Authorization", ("Bearer " + apiKey).toUtf8());
+        leg.body = legBody;
+        if (cfg.perf.stream_upstream)
+        {
+            legStream = std::make_shared<SseCompletionStream>(static_cast<size_t>(processedText.length()),
+                                                              static_cast<size_t>(processedText.toUtf8().size()), sourceZCodes);
+            std::shared_ptr<SseCompletionStream> parser = legStream;
+            leg.onChunk = [parser](const QByteArray &chunk)
+            { return parser->feed(chunk.constData(), static_cast<size_t>(chunk.size())); };
+        }
+        // 对冲时先到达的一方须带有可用译文才算胜出：空白、拒绝或无法解析的应答不应中止另一方
+        if (hedgeDelay >= 0)
+        {
+            std::shared_ptr<SseCompletionStream> parser = legStream;
+            leg.accept = [this, parser](const UpstreamDispatcher::Response &r)
+            { return acceptCompletion(r.body, parser.get()); };
+        }
+        return leg;
+    };
 
-    QNetworkRequest request(QUrl(cfg.api_address + "/chat/completions"));
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setRawHeader("Authorization", ("Bearer " + apiKey).toUtf8());
+    QByteArray body = QByteArray::fromStdString(payload.dump());
+    // Token 按请求体字节粗略预估
+    const int estimatedTokens = static_cast<int>(body.size() / 3) + 256;
 
-    std::unique_ptr<QNetworkReply> reply(threadNam->post(request, QByteArray::fromStdString(payload.dump())));
+    // 🔀 故障转移：主端点上次遇到硬错误，本次直接改走备用端点 (占用备用 Key 的配额，不占主端点的)；
+    // 备用 Key 也在冷却或配额用尽时仍走主端点
+    UpstreamHedging::Target failoverTarget = failover ? m_hedging.next(true) : UpstreamHedging::Target();
+    ApiKeyScheduler *failoverKeys = nullptr;
+    ApiKeyScheduler::Lease failoverLease;
+    if (failoverTarget.valid())
+    {
+        failoverKeys = &keySchedulerFor(failoverTarget.key);
+        failoverLease = failoverKeys->tryAcquire(failoverTarget.key, estimatedTokens);
+        if (failoverLease.valid())
+        {
+            payload["model"] = failoverTarget.model.toStdString();
+            body = QByteArray::fromStdString(payload.dump());
+            emit logMessage(QString(SV_FAILOVER[cfg.language]).arg(QUrl(failoverTarget.url).host(), failoverTarget.model));
+        }
+        else
+        {
+            failoverTarget = UpstreamHedging::Target();
+        }
+    }
 
-    // ==========================================
-    // 🔥 异步轮询事件泵 (Async Polling Event Pump)
-    // 彻底解决原生 std::thread 中导致 stopServer 卡死的问题！
-    // ==========================================
-    QEventLoop loop;
-    QElapsedTimer timer;
-    timer.start();
-    bool isTimeout = false;
+    // 停止服务、客户端超时或断开时，排队、等待与进行中的上游请求都立即结束
+    auto shouldAbort = [this, &deadline]()
+    { return m_stopRequested.load(std::memory_order_relaxed) || deadline.abandoned(); };
 
-    while (!reply->isFinished())
+    // 🔑 按健康度与 RPM/TPM 配额挑选 Key
+    ApiKeyScheduler::Lease keyLease;
+    if (!failoverTarget.valid())
     {
-        if (m_stopRequested.load(std::memory_order_relaxed))
+        keyLease = m_keyScheduler.acquire(estimatedTokens, std::chrono::milliseconds(deadline.clamp(10000)), shouldAbort);
+        if (!keyLease.valid())
         {
-            reply->abort();
-            threadNam->clearAccessCache();
-            threadNam->clearConnectionCache();
-            break;
+            if (shouldAbort())
+            {
+                failure = AttemptFailure::Aborted;
+                return "";
+            }
+            emit logMessage("<font color='#F44336'>❌ " + QString(SV_KEYS_EXHAUSTED[cfg.language]) + "</font>");
+            failure = AttemptFailure::Throttled;
+            return "";
         }
+    }
+
+    // 🎚️ 自适应并发：超出当前限额的请求在此按优先级廉价排队，不去冲击正在限流的上游
+    if (!m_limiter.acquire(priority, shouldAbort))
+    {
+        m_keyScheduler.release(keyLease, 0, std::chrono::milliseconds(0));
+        if (failoverLease.valid())
+            failoverKeys->release(failoverLease, 0, std::chrono::milliseconds(0));
+        failure = AttemptFailure::Aborted;
+        return "";
+    }
 
-        if (timer.elapsed() > 40000)
+    std::shared_ptr<SseCompletionStream> stream;
+    std::shared_ptr<SseCompletionStream> hedgeStream;
+    hedgeDelay = failoverTarget.valid() ? -1 : m_hedging.hedgeDelayMs();
+    const UpstreamDispatcher::Leg primaryLeg = failoverTarget.valid() ? makeLeg(failoverTarget.url, failoverTarget.key, body, stream)
+                                                                      : makeLeg(cfg.api_address, keyLease.key, body, stream);
+
+    // 副本同样占用一个并发许可与备用 Key 的配额：有请求在限流处排队、限额已满或备用 Key 不可用时不对冲，
+    // 以免给过载的上游雪上加霜
+    QString hedgeHost;
+    ApiKeyScheduler *hedgeKeys = nullptr;
+    ApiKeyScheduler::Lease hedgeLease;
+    auto makeHedge = [&]() -> std::optional<UpstreamDispatcher::Leg>
+    {
+        const UpstreamHedging::Target target = m_hedging.next(false);
+        if (!target.valid())
+            return std::nullopt;
+        ApiKeyScheduler &keys = keySchedulerFor(target.key);
+        const ApiKeyScheduler::Lease lease = keys.tryAcquire(target.key, estimatedTokens);
+        if (!lease.valid())
+            return std::nullopt;
+        if (!m_limiter.tryAcquire())
         {
-            isTimeout = true;
-            reply->abort();
-            break;
+            keys.release(lease, 0, std::chrono::milliseconds(0));
+            return std::nullopt;
         }
+        hedgeKeys = &keys;
+        hedgeLease = lease;
+        hedgeHost = QUrl(target.url).host();
+        json hedgePayload = payload;
+        hedgePayload["model"] = target.model.toStdString();
+        return makeLeg(target.url, target.key, QByteArray::fromStdString(hedgePayload.dump()), hedgeStream);
+    };
 
-        loop.processEvents(QEventLoop::AllEvents, 50);
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    // ==========================================
+    // 🚀 交给上游调度器：网络栈在专用 I/O 线程中运行，
+    // 本线程只在条件变量上等待，完成即被唤醒，停止服务时由 abortAll 立即中止
+    // ==========================================
+    // 单次尝试的超时不超过请求剩余的时间
+    const int upstreamTimeoutMs = std::max(1, cfg.perf.upstream_timeout_ms);
+    const int attemptTimeoutMs = static_cast<int>(deadline.clamp(upstreamTimeoutMs));
+    QElapsedTimer upstreamTimer;
+    upstreamTimer.start();
+    const UpstreamDispatcher::HedgedResponse hedged = m_upstream.postHedged(primaryLeg, hedgeDelay, makeHedge, attemptTimeoutMs, shouldAbort);
+    const qint64 primaryMs = upstreamTimer.elapsed();
+    // 主支路的应答决定 Key 健康度、并发限额与延迟统计；译文取自胜出的一方
+    const UpstreamDispatcher::Response &primaryReply = hedged.primary;
+    const UpstreamDispatcher::Response &reply = hedged.winner();
+    if (hedged.hedgeWon)
+        stream = hedgeStream;
+    if (hedgeLease.valid())
+    {
+        // 副本的结果只计入其 Key 的健康度，不作为主端点的负载信号
+        hedgeKeys->release(hedgeLease, hedged.hedge.httpStatus, parseRetryAfter(hedged.hedge.retryAfter));
+        m_limiter.release(ConcurrencyLimiter::Signal::Ignore, priority, std::chrono::milliseconds(0));
+    }
+    if (hedged.hedged)
+    {
+        m_hedging.recordHedge(hedged.hedgeWon);
+        if (cfg.enable_debug_mode)
+            emit logMessage(QString(SV_HEDGE_RESULT[cfg.language]).arg(hedgeDelay).arg(hedgeHost).arg(hedged.hedgeWon ? "✔" : "✘"));
+    }
+    if (!failoverTarget.valid() &&
+        (hedged.hedgeWon || (!primaryReply.aborted && !primaryReply.timedOut && primaryReply.error == QNetworkReply::NoError)))
+        m_hedging.recordPrimaryLatency(primaryMs);
+
+    const std::chrono::milliseconds retryAfter = parseRetryAfter(primaryReply.retryAfter);
+    outcome.httpStatus = reply.httpStatus;
+    outcome.retryAfter = retryAfter;
+    if (keyLease.valid())
+    {
+        const ApiKeyScheduler::Event keyEvent = m_keyScheduler.release(keyLease, primaryReply.httpStatus, retryAfter);
+        if (keyEvent == ApiKeyScheduler::Event::Cooldown)
+            emit logMessage(QString(SV_KEY_COOLDOWN[cfg.language]).arg(ApiKeyScheduler::label(keyLease.key)));
+        else if (keyEvent == ApiKeyScheduler::Event::Quarantine)
+            emit logMessage(QString(SV_KEY_QUARANTINE[cfg.language]).arg(ApiKeyScheduler::label(keyLease.key)).arg(primaryReply.httpStatus));
+        publishKeyStats(keyEvent != ApiKeyScheduler::Event::None);
+    }
+    if (failoverLease.valid())
+        failoverKeys->release(failoverLease, primaryReply.httpStatus, retryAfter);
+    {
+        // 故障转移到备用端点时，其表现不代表主端点的负载
+        ConcurrencyLimiter::Signal signal = ConcurrencyLimiter::Signal::Ignore;
+        if (!failoverTarget.valid())
+        {
+            // 被截止时间压短的超时不说明上游过载
+            const bool fullTimeout = primaryReply.timedOut && attemptTimeoutMs >= upstreamTimeoutMs;
+            if (fullTimeout || primaryReply.httpStatus == 429 || primaryReply.httpStatus >= 500)
+                signal = ConcurrencyLimiter::Signal::Overload;
+            else if (primaryReply.error == QNetworkReply::NoError || primaryReply.stoppedEarly)
+                signal = ConcurrencyLimiter::Signal::Success;
+        }
+        // 429 的 Retry-After 只针对当前 Key，已由 Key 调度器冷却，不暂停其它 Key 的请求
+        const int newLimit = m_limiter.release(signal, priority, std::chrono::milliseconds(primaryMs),
+                                               primaryReply.httpStatus == 429 ? std::chrono::milliseconds(0) : retryAfter);
+        if (newLimit > 0 && cfg.enable_debug_mode && signal == ConcurrencyLimiter::Signal::Overload)
+            emit logMessage(QString(SV_LIMIT_DOWN[cfg.language]).arg(primaryReply.timedOut ? QString("timeout") : QString::number(primaryReply.httpStatus)).arg(newLimit));
     }
 
-    if (m_stopRequested.load(std::memory_order_relaxed))
+    if (reply.stoppedEarly && !m_stopRequested.load(std::memory_order_relaxed))
+    {
+        emit logMessage(QString(SV_STREAM_ABORTED[cfg.language]).arg(QString::fromStdString(stream->abortReason())));
+        failure = AttemptFailure::Rejected;
+        return "";
+    }
+
+    if (m_stopRequested.load(std::memory_order_relaxed) || reply.aborted)
+    {
+        failure = AttemptFailure::Aborted;
         return "";
+    }
 
-    if (isTimeout)
+    if (reply.timedOut)
     {
         emit logMessage("<font color='#F44336'>❌ Request Timeout</font>");
+        failure = AttemptFailure::Timeout;
         return ""; 
     }
 
     // --- ⬇️ 解析流程 ⬇️ ---
     QString resultText = "";
-    if (reply->error() == QNetworkReply::NoError)
+    if (reply.error == QNetworkReply::NoError)
     {
-        QByteArray responseBytes = reply->readAll();
+        const QByteArray &responseBytes = reply.body;
         try
         {
-            json response = json::parse(responseBytes.toStdString());
-            if (response.contains("usage"))
+            json response;
+            if (stream && stream->sawEvents())
+            {
+                // 把累积的增量内容还原成非流式应答的形状，后续流程保持不变
+                response["choices"] = json::array({{{"message", {{"content", stream->content()}}}}});
+                if (stream->usage().is_object())
+                    response["usage"] = stream->usage();
+            }
+            else
+            {
+                // 直接解析应答缓冲区，不再先复制成 std::string
+                response = json::parse(responseBytes.constBegin(), responseBytes.constEnd());
+            }
+            if (response.contains("usage") && response["usage"].is_object())
             {
-                int p = response["usage"].value("prompt_tokens", 0);
-                int c = response["usage"].value("completion_tokens", 0);
+                const json &usage = response["usage"];
+                int p = usage.value("prompt_tokens", 0);
+                int c = usage.value("completion_tokens", 0);
                 if (p > 0 || c > 0)
+                {
                     emit tokenUsageReceived(p, c);
+                    // 用量记在实际发出胜出请求的 Key 上
+                    if (hedged.hedgeWon)
+                        hedgeKeys->recordUsage(hedgeLease, p + c);
+                    else if (failoverLease.valid())
+                        failoverKeys->recordUsage(failoverLease, p + c);
+                    else
+                        m_keyScheduler.recordUsage(keyLease, p + c);
+                }
+
+                // 各家上报缓存命中的字段不同：OpenAI / OpenRouter、DeepSeek、Anthropic 兼容端点
+                int cached = 0;
+                if (usage.contains("prompt_tokens_details") && usage["prompt_tokens_details"].is_object())
+                    cached = usage["prompt_tokens_details"].value("cached_tokens", 0);
+                if (cached == 0)
+                    cached = usage.value("prompt_cache_hit_tokens", 0);
+                if (cached == 0)
+                    cached = usage.value("cache_read_input_tokens", 0);
+                m_promptTokens += static_cast<quint64>(std::max(0, p));
+                m_cachedPromptTokens += static_cast<quint64>(std::max(0, cached));
+                if (cfg.enable_debug_mode && cached > 0)
+                    emit logMessage(QString(SV_PROMPT_CACHE[cfg.language]).arg(cached).arg(p));
             }
 
             if (response.contains("choices") && !response["choices"].empty())
             {
-                std::string content = response["choices"][0]["message"]["content"];
-                QString cleanContent = QString::fromStdString(content);
+                const std::string &content = response["choices"][0]["message"]["content"].get_ref<const std::string &>();
+                QString cleanContent = QString::fromUtf8(content.data(), static_cast<qsizetype>(content.size()));
 
                 static const QRegularExpression thinkTag(R"(<think(?:ing)?>.*?</think(?:ing)?>)", QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
                 static const QRegularExpression thinkTagShort(R"(</?think(?:ing)?>)", QRegularExpression::CaseInsensitiveOption);
@@ -929,7 +1923,7 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
                         if (k.isEmpty() || v.isEmpty() || k.contains(tokenRegex) || v.contains(tokenRegex) || k.contains(lfRegex) || v.contains(lfRegex) || k.contains(termCodeRegex) || v.contains(termCodeRegex))
                             isValidTerm = false;
 
-                        if (isValidTerm && processedText.contains(k, Qt::CaseInsensitive))
+                        if (isValidTerm && allowNewTerms && processedText.contains(k, Qt::CaseInsensitive))
                         {
                             GlossaryManager::instance().addNewTerm(k, v);
                             emit logMessage(QString(SV_NEW_TERM[cfg.language]) + "<b>" + k + "</b> = <b>" + v + "</b>");
@@ -985,7 +1979,7 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
                 if (hasRotate && !resultText.isEmpty()) {
                     QString rewrapped;
                     // 精准匹配：忽略已存在的 HTML 标签、忽略空白和换行，只给实体字符穿戴！
-                    QRegularExpression tokenMatcher(R"(<[^>]+>|\[LF\]|\r?\n|\s+|.)", QRegularExpression::DotMatchesEverythingOption);
+                    static const QRegularExpression tokenMatcher(R"(<[^>]+>|\[LF\]|\r?\n|\s+|.)", QRegularExpression::DotMatchesEverythingOption);
                     QRegularExpressionMatchIterator rit = tokenMatcher.globalMatch(resultText);
                     while (rit.hasNext()) {
                         QString token = rit.next().captured(0);
@@ -1000,46 +1994,390 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
 
                 if (isValidTranslationResult(resultText))
                 {
-                    std::lock_guard<std::mutex> lock(m_contextMutex);
-                    Context &ctx = m_contexts[clientId];
-                    ctx.history.push_back({currentUserContent, resultText});
-                    while (ctx.history.size() > ctx.max_len)
-                        ctx.history.pop_front();
+                    if (useHistory)
+                    {
+                        std::lock_guard<std::mutex> lock(m_contextMutex);
+                        Context &ctx = m_contexts[clientId];
+                        ctx.history.push_back({currentUserContent, resultText.toStdString()});
+                        while (ctx.history.size() > ctx.max_len)
+                            ctx.history.pop_front();
+                    }
                 }
                 else
                 {
+                    failure = AttemptFailure::Rejected;
                     resultText = "";
                 }
             }
             else
             {
                 emit logMessage("<font color='#F44336'>❌ " + QString(SV_ERR_FMT[cfg.language]) + "</font>");
+                failure = AttemptFailure::BadResponse;
                 resultText = "";
             }
         }
         catch (...)
         {
             emit logMessage("<font color='#F44336'>❌ " + QString(SV_ERR_JSON[cfg.language]) + "</font>");
+            failure = AttemptFailure::BadResponse;
             resultText = "";
         }
     }
     else
     {
-        emit logMessage("<font color='#F44336'>❌ Network Error: " + reply->errorString() + "</font>");
+        emit logMessage("<font color='#F44336'>❌ Network Error: " + reply.errorString + "</font>");
+        // 按 HTTP 状态细分，供重试策略决定退避方式或直接放弃 (408 属于超时，可重试)
+        if (reply.httpStatus == 429)
+            failure = AttemptFailure::RateLimited;
+        else if (reply.httpStatus >= 500)
+            failure = AttemptFailure::ServerError;
+        else if (reply.httpStatus >= 400 && reply.httpStatus != 408)
+            failure = AttemptFailure::ClientError;
+        else
+            failure = AttemptFailure::Network;
         resultText = "";
     }
     
     return resultText;
 }
 
-QString TranslationServer::getNextApiKey()
+void TranslationServer::publishKeyStats(bool force)
 {
-    std::lock_guard<std::mutex> lock(m_keyMutex);
-    if (m_apiKeys.empty())
-        return "";
-    QString key = m_apiKeys[m_currentKeyIndex];
-    m_currentKeyIndex = (m_currentKeyIndex + 1) % m_apiKeys.size();
-    return key;
+    // UI 刷新节流：最多每秒一次
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 last = m_lastKeyStatsMs.load();
+    if (!force && now - last < 1000)
+        return;
+    if (!m_lastKeyStatsMs.compare_exchange_strong(last, now))
+        return;
+
+    QStringList lines;
+    for (const ApiKeyScheduler::KeyStats &ks : m_keyScheduler.stats())
+    {
+        QString line = QString("%1  in-flight %2 | req %3 | err %4 | 429 %5 | tokens %6")
+                           .arg(ks.label).arg(ks.inFlight).arg(ks.requests).arg(ks.errors).arg(ks.throttled).arg(ks.tokens);
+        if (ks.quarantined)
+            line += "  ⛔";
+        else if (ks.cooldownMs > 0)
+            line += QString("  ⏳%1s").arg((ks.cooldownMs + 999) / 1000);
+        lines << line;
+    }
+    emit apiKeyStatsUpdated(lines.join('\n'));
+}
+
+QString TranslationServer::cacheNamespace()
+{
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    return m_configFingerprint;
+}
+
+QString TranslationServer::memoryNamespace(const QString &ns, const QString &text)
+{
+    // 术语表只影响包含这些术语的原文：按命中术语的指纹细分，自动学习新术语不会让整个译文记忆失效
+    if (!m_glossaryEnabled.load())
+        return ns;
+    return ns + "-" + QString::number(GlossaryManager::instance().fingerprint(text), 16);
+}
+
+json TranslationServer::collectStats()
+{
+    json stats;
+    TranslationCache::Stats st = m_cache.stats();
+    stats["cache"] = {
+        {"enabled", m_cache.isOpen()},
+        {"hits", st.hits},
+        {"misses", st.misses},
+        {"evictions", st.evictions},
+        {"entries", st.entries},
+        {"bytes", st.bytes},
+        {"budget_bytes", st.budget},
+        {"file_bytes", st.fileBytes}};
+    stats["warm_index"] = {{"entries", m_warmIndex.size()}};
+    const quint64 promptTokens = m_promptTokens.load();
+    const quint64 cachedTokens = m_cachedPromptTokens.load();
+    bool cacheLayout = false;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        cacheLayout = m_config.perf.prompt_cache_layout;
+    }
+    stats["prompt_cache"] = {
+        {"layout", cacheLayout},
+        {"prompt_tokens", promptTokens},
+        {"cached_tokens", cachedTokens},
+        {"hit_ratio", promptTokens > 0 ? static_cast<double>(cachedTokens) / promptTokens : 0.0}};
+    json upstream = json::object();
+    for (const auto &entry : m_upstream.hostStats())
+    {
+        const UpstreamDispatcher::HostStats &hs = entry.second;
+        upstream[entry.first.toStdString()] = {
+            {"requests", hs.requests},
+            {"tls_handshakes", hs.handshakes},
+            {"reused", hs.requests > hs.handshakes ? hs.requests - hs.handshakes : 0},
+            {"http2", hs.http2},
+            {"prewarmed", hs.prewarms}};
+    }
+    stats["upstream"] = upstream;
+    const MicroBatcher::Stats mb = m_microBatcher.stats();
+    stats["micro_batch"] = {
+        {"enabled", m_microBatcher.enabled()},
+        {"batches", mb.batches},
+        {"items", mb.items},
+        {"fallbacks", mb.fallbacks}};
+    stats["http_pool"] = {
+        {"threads", m_httpPool.live.load()},
+        {"busy", m_httpPool.busy.load()},
+        {"peak", m_httpPool.peak.load()},
+        {"queued", m_httpPool.queued.load()},
+        {"spawned", m_httpPool.spawned.load()}};
+    const AdmissionController::Stats as = m_admission.stats();
+    stats["admission"] = {
+        {"pending", as.pending},
+        {"peak_pending", as.peakPending},
+        {"admitted", as.admitted},
+        {"shed_queue_full", as.shedFull},
+        {"shed_over_budget", as.shedBudget},
+        {"cancelled_client_gone", m_clientGone.load()},
+        {"queue_delay_ms", m_limiter.headWaitMs()},
+        {"max_pending", as.maxPending},
+        {"queue_budget_ms", as.queueBudgetMs}};
+    const ConcurrencyLimiter::Stats ls = m_limiter.stats();
+    stats["concurrency"] = {
+        {"limit", ls.limit},
+        {"in_flight", ls.inFlight},
+        {"queued", ls.queued},
+        {"overloads", ls.overloads},
+        {"paused_ms", ls.pausedMs}};
+    json classes = json::object();
+    const char *classNames[ConcurrencyLimiter::PRIORITY_COUNT] = {"dialogue", "short_batch", "long_batch"};
+    for (int i = 0; i < ConcurrencyLimiter::PRIORITY_COUNT; ++i)
+    {
+        const ConcurrencyLimiter::ClassStats &cs = ls.classes[i];
+        classes[classNames[i]] = {{"queued", cs.queued},
+                                  {"granted", cs.granted},
+                                  {"aged", cs.aged},
+                                  {"avg_wait_ms", cs.granted ? cs.totalWaitMs / static_cast<qint64>(cs.granted) : 0},
+                                  {"latency_baseline_ms", cs.baselineMs}};
+    }
+    stats["concurrency"]["priorities"] = classes;
+    const UpstreamHedging::Stats hedging = m_hedging.stats();
+    stats["hedging"] = {{"endpoints", hedging.endpoints},
+                        {"p90_ms", hedging.p90Ms},
+                        {"hedged", hedging.hedged},
+                        {"hedge_wins", hedging.hedgeWins},
+                        {"failovers", hedging.failovers}};
+
+    json keys = json::array();
+    for (const ApiKeyScheduler::KeyStats &ks : m_keyScheduler.stats())
+    {
+        keys.push_back({{"key", ks.label.toStdString()},
+                        {"in_flight", ks.inFlight},
+                        {"requests", ks.requests},
+                        {"errors", ks.errors},
+                        {"throttled", ks.throttled},
+                        {"tokens", ks.tokens},
+                        {"rpm_limit", ks.rpmLimit},
+                        {"tpm_limit", ks.tpmLimit},
+                        {"cooldown_ms", ks.cooldownMs},
+                        {"quarantined", ks.quarantined}});
+    }
+    stats["api_keys"] = keys;
+    stats["negative_cache"] = {
+        {"enabled", m_negativeEnabled.load()},
+        {"entries", m_negativeCache.size()},
+        {"hits", m_negativeHits.load()}};
+    return stats;
+}
+
+bool TranslationServer::lookupMemory(const QString &ns, const QString &text, QString &translation, bool *fromTemplate)
+{
+    const QString keyNs = m_cache.isOpen() ? memoryNamespace(ns, text) : QString();
+    if (m_cache.isOpen())
+    {
+        std::string cached;
+        if (m_cache.lookup(TranslationCache::makeKey(keyNs, text), cached))
+        {
+            translation = QString::fromStdString(cached);
+            return true;
+        }
+    }
+
+    // 热启动索引里的原文使用真实换行，Custom 通道的文本此时已被替换为 [LF]
+    const bool usesLfToken = text.contains("[LF]");
+    QString probe = TranslationCache::normalize(text);
+    if (usesLfToken)
+        probe.replace("[LF]", "\n");
+    if (m_warmIndex.lookup(probe, translation))
+    {
+        if (usesLfToken)
+        {
+            translation.replace("\r\n", "\n");
+            translation.replace("\n", "[LF]");
+        }
+        return true;
+    }
+
+    // 🧩 模板记忆：仅数字不同的文本共享同一份模板译文，命中后回填当前数值
+    if (m_cache.isOpen())
+    {
+        QString templateKey;
+        QStringList slotValues;
+        if (!makeTemplateKey(text, templateKey, slotValues))
+            return false;
+        std::string cached;
+        if (!m_cache.lookup(TranslationCache::makeKey(keyNs, templateKey), cached))
+            return false;
+        QString filled = QString::fromStdString(cached);
+        for (int k = 0; k < slotValues.size(); ++k)
+            filled.replace(QString("[N_%1]").arg(k), slotValues[k]);
+        translation = filled;
+        if (fromTemplate)
+            *fromTemplate = true;
+        return true;
+    }
+    return false;
+}
+
+void TranslationServer::rememberTranslation(const QString &ns, const QString &text, const QString &translation)
+{
+    if (!m_cache.isOpen() || translation.isEmpty())
+        return;
+    const QString keyNs = memoryNamespace(ns, text);
+    m_cache.insert(TranslationCache::makeKey(keyNs, text), translation.toStdString());
+
+    // 反推模板译文：每个数字槽位必须在译文中恰好出现一次，否则无法安全回填
+    QString templateKey;
+    QStringList slotValues;
+    if (!makeTemplateKey(text, templateKey, slotValues))
+        return;
+    if (QSet<QString>(slotValues.begin(), slotValues.end()).size() != slotValues.size())
+        return;
+
+    // 先在原译文上定位全部槽位，再一次性重建，避免已写入的 [N_x] 被后续数值误匹配
+    std::vector<std::pair<int, int>> spans; // (起始位置, 槽位序号)
+    for (int k = 0; k < slotValues.size(); ++k)
+    {
+        QRegularExpression valueExp(R"((?<![\d.,]))" + QRegularExpression::escape(slotValues[k]) + R"((?![\d]|[.,]\d))");
+        QRegularExpressionMatchIterator it = valueExp.globalMatch(translation);
+        if (!it.hasNext())
+            return;
+        spans.push_back({static_cast<int>(it.next().capturedStart()), k});
+        if (it.hasNext())
+            return;
+    }
+    std::sort(spans.begin(), spans.end());
+
+    QString templated;
+    int lastEnd = 0;
+    for (const auto &span : spans)
+    {
+        if (span.first < lastEnd)
+            return; // 槽位重叠
+        templated.append(translation.mid(lastEnd, span.first - lastEnd));
+        templated.append(QString("[N_%1]").arg(span.second));
+        lastEnd = span.first + slotValues[span.second].length();
+    }
+    templated.append(translation.mid(lastEnd));
+    m_cache.insert(TranslationCache::makeKey(keyNs, templateKey), templated.toStdString());
+}
+
+bool TranslationServer::makeTemplateKey(const QString &text, QString &templateKey, QStringList &slotValues)
+{
+    // 多行批量载荷不做模板化，避免生成巨大且几乎不可能复用的模板
+    if (text.contains('\n'))
+        return false;
+
+    EscapeMap ctx;
+    QString frozen = freezeEscapesLocal(TranslationCache::normalize(text), ctx, true);
+
+    // 重新按出现顺序编号：数字槽位 [N_0..]，标签/变量原样拼入键中以区分不同标签
+    static const QRegularExpression tokenExp(R"(\[(T|N)_(\d+)\])");
+    QString key;
+    QStringList tags;
+    slotValues.clear();
+    int lastEnd = 0;
+    QRegularExpressionMatchIterator it = tokenExp.globalMatch(frozen);
+    while (it.hasNext())
+    {
+        QRegularExpressionMatch match = it.next();
+        key.append(frozen.mid(lastEnd, match.capturedStart() - lastEnd));
+        const QString original = ctx.map.value(match.captured(0));
+        if (match.captured(1) == "N")
+        {
+            key.append(QString("[N_%1]").arg(slotValues.size()));
+            slotValues << original;
+        }
+        else
+        {
+            key.append(match.captured(0));
+            tags << original;
+        }
+        lastEnd = match.capturedEnd();
+    }
+    key.append(frozen.mid(lastEnd));
+
+    if (slotValues.isEmpty())
+        return false;
+    templateKey = "🧩" + key + "\x1e" + tags.join("\x1f");
+    return true;
+}
+
+void TranslationServer::startWarmStart(const QString &glossaryPath, int lang)
+{
+    stopWarmStart();
+    m_warmIndex.clear();
+    m_warmCancel = false;
+
+    // 译文文件与术语表 (_Substitutions.txt) 位于同一 Translation/<lang>/Text 目录
+    const QString dirPath = QFileInfo(glossaryPath).absolutePath();
+    m_warmThread = new std::thread([this, dirPath, lang]()
+                                   {
+        QElapsedTimer timer;
+        timer.start();
+        const QStringList files = XuaTranslationIndex::collectFiles(dirPath);
+        for (const QString &file : files)
+        {
+            if (m_warmCancel.load(std::memory_order_relaxed))
+                return;
+            m_warmIndex.loadFile(file, m_warmCancel);
+        }
+        if (!files.isEmpty() && !m_warmCancel.load(std::memory_order_relaxed))
+            emit logMessage(QString(SV_WARM_LOADED[lang]).arg(m_warmIndex.size()).arg(files.size()).arg(timer.elapsed())); });
+}
+
+void TranslationServer::startCacheLoad(const QString &path, size_t budgetBytes, int lang)
+{
+    stopCacheLoad();
+    m_cacheCancel = false;
+    m_cacheThread = new std::thread([this, path, budgetBytes, lang]()
+                                    {
+        QElapsedTimer timer;
+        timer.start();
+        if (m_cache.open(path, budgetBytes, m_cacheCancel))
+            emit logMessage(QString(SV_CACHE_LOADED[lang]).arg(m_cache.size()).arg(timer.elapsed()));
+        else if (!m_cacheCancel.load(std::memory_order_relaxed))
+            emit logMessage(QString(SV_CACHE_FAILED[lang]).arg(path)); });
+}
+
+void TranslationServer::stopCacheLoad()
+{
+    m_cacheCancel = true;
+    if (m_cacheThread && m_cacheThread->joinable())
+    {
+        m_cacheThread->join();
+        delete m_cacheThread;
+        m_cacheThread = nullptr;
+    }
+}
+
+void TranslationServer::stopWarmStart()
+{
+    m_warmCancel = true;
+    if (m_warmThread && m_warmThread->joinable())
+    {
+        m_warmThread->join();
+        delete m_warmThread;
+        m_warmThread = nullptr;
+    }
 }
 
 QString TranslationServer::generateClientId(const std::string &ip)
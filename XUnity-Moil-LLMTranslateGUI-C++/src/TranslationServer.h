@@ -9,14 +9,42 @@
 #include <map>
 #include <atomic> 
 #include <thread> 
+#include <memory>
+#include <condition_variable>
 #include "ConfigManager.h"
+#include "TranslationCache.h"
+#include "NegativeCache.h"
+#include "UpstreamDispatcher.h"
+#include "MicroBatcher.h"
+#include "ConcurrencyLimiter.h"
+#include "ApiKeyScheduler.h"
+#include "UpstreamHedging.h"
+#include "RetryPolicy.h"
+#include "RequestDeadline.h"
+#include "ElasticTaskQueue.h"
+#include "AdmissionController.h"
+#include "XuaTranslationIndex.h"
 #include "httplib.h"
+#include "json.hpp"
 
 struct Context {
-    std::deque<std::pair<QString, QString>> history; 
+    // 历史对话以 UTF-8 保存，组装请求时无需逐条转换
+    std::deque<std::pair<std::string, std::string>> history; 
     int max_len; 
 };
 
+// 进行中的翻译：首个请求负责上游调用，相同文本的并发请求在此等待结果
+struct InFlightTranslation {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    QString result;
+    // 仍在等待结果的跟随者数：为 0 且发起者的客户端已断开时，上游调用才可以取消
+    std::atomic<int> waiters{0};
+    // 发起者只因自己的客户端超时或断开而放弃：空结果不代表翻译失败，仍有时间的跟随者自行重试
+    bool abandoned = false;
+};
+
 class TranslationServer : public QObject {
     Q_OBJECT
     
@@ -32,28 +60,83 @@ public:
     AppConfig getConfig(); 
     
     void startServer();
-    void stopServer();
+    // drain 为 true 时先排空：拒绝新请求，等待进行中的翻译完成 (最长 drain_timeout_ms) 后再停止；
+    // 排空期间再次调用则立即强制中止
+    void stopServer(bool drain = true);
     
     void clearAllContexts();
     bool isRunning() const { return m_running; }
 
+    // 📚 离线批量预翻译：不监听端口，只拉起翻译流水线 (上游、译文记忆、限流、重试)
+    void startOffline();
+    void stopOffline();
+    // 离线翻译一组文本：多条时按编号打包成一次请求，未能对位的条目逐条补译；失败的条目为空串
+    QStringList translateOffline(const QStringList& texts);
+
 signals:
     void logMessage(QString msg);
     void tokenUsageReceived(int prompt, int completion);
+    // 各 API Key 的运行统计 (已脱敏，每行一个 Key)
+    void apiKeyStatsUpdated(QString summary);
     void workStarted();
     void workFinished(bool success);
     void serverStarted();
     void serverStopped();
+    // 端口监听失败 (服务线程随即退出)
+    void listenFailed(int port);
 
 private:
     void runServerLoop();
-    QString performTranslation(const QString& text, const QString& clientIP);
-    QString getNextApiKey();
+    // 启动翻译流水线 (HTTP 服务与离线预翻译共用)
+    void startPipeline();
+    // deadline 为客户端愿意等待的截止时间，重试与每次上游尝试都不会超过它；clientIP 为空表示不使用上下文历史
+    // priority 决定在并发限流处排队时的优先级；remember 为 false 时译文不整条写入记忆 (调用方自行逐行写回)
+    QString performTranslation(const QString& text, const QString& clientIP, const RequestDeadline& deadline = RequestDeadline(),
+                               ConcurrencyLimiter::Priority priority = ConcurrencyLimiter::Priority::ShortBatch, bool remember = true);
+    // 真正的上游调用 (含重试)，不经过缓存与单飞合并；numberedBatch 为 true 时按 [#n] 编号批次发送，不读写上下文历史
+    QString performUpstreamTranslation(const QString& text, const QString& clientIP, const RequestDeadline& deadline,
+                                       ConcurrencyLimiter::Priority priority, AttemptFailure* lastFailure = nullptr,
+                                       bool numberedBatch = false);
+    // 📦 [Custom] 通道入口：开启微批时与并发到达的其它文本合并成一次请求
+    QString translateCustomText(const QString& text, const QString& clientIP, const RequestDeadline& deadline);
+    // 组长执行：编号多行打包翻译，并按行分发结果
+    std::vector<std::optional<QString>> runCustomBatch(const QStringList& texts, const QString& clientIP, const RequestDeadline& deadline,
+                                                       ConcurrencyLimiter::Priority priority = ConcurrencyLimiter::Priority::Dialogue);
+    // 向界面发布各 Key 的统计 (节流，force 时立即发布)
+    void publishKeyStats(bool force);
     QString generateClientId(const std::string& ip);
 
-    QString performSingleTranslationAttempt(const QString& text, const QString& clientIP);
+    // 💾 译文记忆命名空间：模型 + 提示词 + 术语表开关，任一变化即自动失效
+    QString cacheNamespace();
+    // 单条原文实际使用的命名空间：术语表开启时再加上该原文命中的术语指纹
+    QString memoryNamespace(const QString& ns, const QString& text);
+    // 依次查询译文记忆与热启动索引
+    bool lookupMemory(const QString& ns, const QString& text, QString& translation, bool* fromTemplate = nullptr);
+    // 写入译文记忆，并在可行时同时写入数字模板
+    void rememberTranslation(const QString& ns, const QString& text, const QString& translation);
+    // 🧩 模板化：数字抽取为 [N_x] 槽位，得到规范模板键与槽位值
+    bool makeTemplateKey(const QString& text, QString& templateKey, QStringList& slotValues);
+    // 📊 汇总各组件的运行统计 (GET /stats)
+    nlohmann::json collectStats();
+    // 后台加载游戏目录下已有的 XUnity 译文文件
+    void startWarmStart(const QString& glossaryPath, int lang);
+    void stopWarmStart();
+    // 后台打开译文记忆 (大文件的映射、建索引与压缩不阻塞界面线程)，完成前查询一律未命中
+    void startCacheLoad(const QString& path, size_t budgetBytes, int lang);
+    void stopCacheLoad();
+
+    // failover 为 true 时改走备用端点 (上一次尝试遇到了硬错误)
+    QString performSingleTranslationAttempt(const QString& text, const QString& clientIP, const RequestDeadline& deadline,
+                                            ConcurrencyLimiter::Priority priority, AttemptOutcome& outcome, bool failover = false,
+                                            bool numberedBatch = false);
+    // 按配置重建对冲/故障转移的备用端点列表 (调用方须持有 m_configMutex)
+    void configureHedging();
+    // 管理该 Key 的调度器：主端点的 Key 归 m_keyScheduler，其余归 m_backupKeys
+    ApiKeyScheduler& keySchedulerFor(const QString& key);
+    // 对冲支路的应答是否带有可用译文 (只做粗检：能取出正文且不是错误/拒绝)
+    bool acceptCompletion(const QByteArray& body, const class SseCompletionStream* stream);
     bool isValidTranslationResult(const QString& result);
-    QString freezeEscapesLocal(const QString& input, struct EscapeMap& context); 
+    QString freezeEscapesLocal(const QString& input, struct EscapeMap& context, bool freezeNumerals = false); 
     QString thawEscapesLocal(const QString& input, const struct EscapeMap& context);
     
     // 🔥 核心外科手术：修复标签丢失与幻觉
@@ -73,18 +156,68 @@ private:
     std::atomic<bool> m_running; 
     std::atomic<bool> m_stopRequested; 
     std::atomic<bool> m_isStopping;
+    // 🛬 排空中：新请求直接 503，进行中的请求继续完成
+    std::atomic<bool> m_draining{false};
 
     std::thread* m_serverThread = nullptr; 
     std::thread* m_cleanupThread = nullptr;
+    std::thread* m_warmThread = nullptr;
+    std::thread* m_cacheThread = nullptr;
 
     httplib::Server* m_svr = nullptr; 
+
+    // 🚀 上游 HTTP 调度器 (专用 I/O 线程)
+    UpstreamDispatcher m_upstream;
+    // 🎚️ 上游并发自适应限流 (AIMD)
+    ConcurrencyLimiter m_limiter;
+    // 🧵 HTTP 连接处理线程池的运行统计
+    ElasticTaskQueue::Counters m_httpPool;
+    // 🚦 准入控制 (积压上限 + 排队延迟预算，超出即 503)
+    AdmissionController m_admission;
+    std::atomic<qint64> m_lastShedLogMs{0};
+    // 🔌 因客户端断开而取消的上游翻译数
+    std::atomic<quint64> m_clientGone{0};
+    // 🏁 对冲请求与多端点故障转移
+    UpstreamHedging m_hedging;
+    // 🔁 按失败类型的重试策略 (指数退避 + 抖动 + Retry-After + 总预算)
+    RetryPolicy m_retryPolicy;
     
     std::map<std::string, Context> m_contexts; 
     std::mutex m_contextMutex; 
     
-    std::vector<QString> m_apiKeys; 
-    int m_currentKeyIndex = 0; 
-    std::mutex m_keyMutex; 
+    // 🔑 API Key 调度 (RPM/TPM 令牌桶、429 冷却、401/403 隔离)
+    ApiKeyScheduler m_keyScheduler;
+    // 🔑 备用端点 (对冲/故障转移) 的 Key：同样计入 RPM/TPM 配额与健康度
+    ApiKeyScheduler m_backupKeys;
+    std::atomic<qint64> m_lastKeyStatsMs{0};
     
     std::mutex m_configMutex;
+
+    // 💾 持久化译文记忆
+    TranslationCache m_cache;
+    QString m_configFingerprint;
+    std::atomic<bool> m_glossaryEnabled{false};
+    // 用户系统提示词 + 翻译协议的 UTF-8 形式 (配置更新时生成，受 m_configMutex 保护)
+    std::shared_ptr<const std::string> m_basePromptUtf8;
+
+    // 🔥 热启动：XUnity 已有译文的精确匹配索引
+    XuaTranslationIndex m_warmIndex;
+    std::atomic<bool> m_warmCancel{false};
+    std::atomic<bool> m_cacheCancel{false};
+
+    // 🚫 负缓存：反复失败的文本在冷却期内直接快速失败
+    NegativeCache m_negativeCache;
+    std::atomic<bool> m_negativeEnabled{true};
+    std::atomic<quint64> m_negativeHits{0};
+
+    // 📦 [Custom] 通道微批聚合
+    MicroBatcher m_microBatcher;
+
+    // ⚡ 上游提示词缓存命中统计 (Token)
+    std::atomic<quint64> m_promptTokens{0};
+    std::atomic<quint64> m_cachedPromptTokens{0};
+
+    // 🛬 单飞合并表 (key 与译文记忆一致)
+    std::map<std::string, std::shared_ptr<InFlightTranslation>> m_inFlight;
+    std::mutex m_inFlightMutex;
 };
\ No newline at end of file
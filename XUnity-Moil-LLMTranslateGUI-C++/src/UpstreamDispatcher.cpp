@@ -0,0 +1,395 @@
+#include "UpstreamDispatcher.h"
+#include <QHttp1Configuration>
+#include <QNetworkAccessManager>
+#include <QThread>
+#if QT_CONFIG(ssl)
+#include <QSslConfiguration>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+
+// 等待者：对冲请求的两条支路共用一个，任一完成都能唤醒等待线程
+struct UpstreamDispatcher::Waiter
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+// 一次上游调用的共享状态：等待线程与 I/O 线程各持有一份 shared_ptr
+struct UpstreamDispatcher::Call
+{
+    std::shared_ptr<Waiter> waiter;
+    // 以下两项受 waiter->mutex 保护
+    bool done = false;
+    Response response;
+
+    std::atomic<bool> cancelled{false};
+    quint64 epoch = 0;
+    // 仅在 I/O 线程中访问
+    QNetworkReply *reply = nullptr;
+    ChunkHandler onChunk;
+    QByteArray streamed;
+    bool stoppedEarly = false;
+};
+
+struct UpstreamDispatcher::Worker
+{
+    QThread thread;
+    // 驻留在 I/O 线程中的上下文对象，所有投递的任务都在它所在线程执行
+    QObject *context = nullptr;
+    // 以下成员仅在 I/O 线程中访问
+    QNetworkAccessManager *nam = nullptr;
+    std::vector<std::shared_ptr<Call>> active;
+};
+
+UpstreamDispatcher::UpstreamDispatcher() = default;
+
+UpstreamDispatcher::~UpstreamDispatcher()
+{
+    stop();
+}
+
+void UpstreamDispatcher::start(int ioThreads, int connectionsPerHost)
+{
+    std::lock_guard<std::mutex> lock(m_workersMutex);
+    if (!m_workers.empty())
+        return;
+
+    m_connectionsPerHost = std::max(1, connectionsPerHost);
+    {
+        std::lock_guard<std::mutex> statsLock(m_statsMutex);
+        m_hostStats.clear();
+    }
+    const int count = std::clamp(ioThreads, 1, 16);
+    for (int i = 0; i < count; ++i)
+    {
+        auto worker = std::make_unique<Worker>();
+        worker->thread.setObjectName(QString("UpstreamIO-%1").arg(i));
+        worker->context = new QObject();
+        worker->context->moveToThread(&worker->thread);
+        // 线程退出时在其内部销毁上下文 (连同作为子对象的 QNetworkAccessManager)
+        QObject::connect(&worker->thread, &QThread::finished, worker->context, &QObject::deleteLater);
+        worker->thread.start();
+        m_workers.push_back(std::move(worker));
+    }
+}
+
+void UpstreamDispatcher::stop()
+{
+    abortAll();
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    {
+        std::lock_guard<std::mutex> lock(m_workersMutex);
+        workers.swap(m_workers);
+    }
+    for (auto &worker : workers)
+    {
+        worker->thread.quit();
+        worker->thread.wait();
+    }
+}
+
+void UpstreamDispatcher::abortAll()
+{
+    m_epoch++;
+
+    std::lock_guard<std::mutex> lock(m_workersMutex);
+    for (auto &worker : m_workers)
+    {
+        Worker *w = worker.get();
+        QMetaObject::invokeMethod(w->context, [w]()
+                                  {
+            // abort 会同步触发 finished，先拷贝一份避免迭代中被修改
+            const std::vector<std::shared_ptr<Call>> calls = w->active;
+            for (const auto &call : calls) {
+                if (call->reply)
+                    call->reply->abort();
+            } }, Qt::QueuedConnection);
+    }
+}
+
+void UpstreamDispatcher::prewarm(const QUrl &url)
+{
+    const QString host = url.host();
+    if (host.isEmpty())
+        return;
+    const bool https = url.scheme().compare("https", Qt::CaseInsensitive) == 0;
+    const quint16 port = static_cast<quint16>(url.port(https ? 443 : 80));
+
+    std::lock_guard<std::mutex> lock(m_workersMutex);
+    for (auto &worker : m_workers)
+    {
+        Worker *w = worker.get();
+        QMetaObject::invokeMethod(w->context, [this, w, host, port, https]()
+                                  {
+            ensureNetwork(w);
+#if QT_CONFIG(ssl)
+            if (https) {
+                // 预连接时同样通过 ALPN 协商 HTTP/2，之后的请求即可直接复用
+                QSslConfiguration conf = QSslConfiguration::defaultConfiguration();
+                conf.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+                w->nam->connectToHostEncrypted(host, port, conf);
+            } else {
+                w->nam->connectToHost(host, port);
+            }
+#else
+            Q_UNUSED(https);
+            w->nam->connectToHost(host, port);
+#endif
+            std::lock_guard<std::mutex> statsLock(m_statsMutex);
+            m_hostStats[host].prewarms++; }, Qt::QueuedConnection);
+    }
+}
+
+std::map<QString, UpstreamDispatcher::HostStats> UpstreamDispatcher::hostStats() const
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_hostStats;
+}
+
+void UpstreamDispatcher::ensureNetwork(Worker *worker)
+{
+    if (worker->nam)
+        return;
+    worker->nam = new QNetworkAccessManager(worker->context);
+#if QT_CONFIG(ssl)
+    // 只有真正新建 TLS 会话的请求才会触发 encrypted，复用连接的请求不会
+    QObject::connect(worker->nam, &QNetworkAccessManager::encrypted, worker->context, [this](QNetworkReply *reply)
+                     {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_hostStats[reply->url().host()].handshakes++; });
+#endif
+}
+
+std::shared_ptr<UpstreamDispatcher::Call> UpstreamDispatcher::launch(const Leg &leg, const std::shared_ptr<Waiter> &waiter, Worker *&worker)
+{
+    auto call = std::make_shared<Call>();
+    call->waiter = waiter;
+    call->epoch = m_epoch.load();
+    call->onChunk = leg.onChunk;
+
+    std::lock_guard<std::mutex> lock(m_workersMutex);
+    if (m_workers.empty())
+        return nullptr;
+    worker = m_workers[m_nextWorker++ % m_workers.size()].get();
+    const QNetworkRequest request = leg.request;
+    const QByteArray body = leg.body;
+    QMetaObject::invokeMethod(worker->context, [this, worker, call, request, body]()
+                              { startCall(worker, call, request, body); }, Qt::QueuedConnection);
+    return call;
+}
+
+void UpstreamDispatcher::cancel(Worker *worker, const std::shared_ptr<Call> &call)
+{
+    // 标记后投递 abort；尚未发出的请求会在 startCall 中直接跳过
+    call->cancelled = true;
+    QMetaObject::invokeMethod(worker->context, [call]()
+                              {
+        if (call->reply)
+            call->reply->abort(); }, Qt::QueuedConnection);
+}
+
+UpstreamDispatcher::HedgedResponse UpstreamDispatcher::postHedged(const Leg &primary, qint64 hedgeDelayMs,
+                                                                  const std::function<std::optional<Leg>()> &makeHedge,
+                                                                  int timeoutMs, const std::function<bool()> &shouldAbort)
+{
+    HedgedResponse result;
+    auto waiter = std::make_shared<Waiter>();
+    Worker *primaryWorker = nullptr;
+    Worker *hedgeWorker = nullptr;
+    const std::shared_ptr<Call> first = launch(primary, waiter, primaryWorker);
+    if (!first)
+    {
+        result.primary.aborted = true;
+        return result;
+    }
+    std::shared_ptr<Call> second;
+    std::function<bool(const Response &)> secondAccept;
+
+    // 各支路完成后只判定一次 (-1 未判定)；内容校验可能较重，在锁外进行
+    int firstValid = -1;
+    int secondValid = -1;
+    auto judge = [](const Response &r, const std::function<bool(const Response &)> &accept)
+    { return r.error == QNetworkReply::NoError && !r.aborted && !r.stoppedEarly && (!accept || accept(r)) ? 1 : 0; };
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::milliseconds(timeoutMs);
+    const auto hedgeAt = start + std::chrono::milliseconds(std::max<qint64>(0, hedgeDelayMs));
+    bool hedgeTried = hedgeDelayMs < 0 || !makeHedge;
+    const auto slice = std::chrono::milliseconds(100);
+
+    std::unique_lock<std::mutex> lock(waiter->mutex);
+    for (;;)
+    {
+        // 完成后应答不再变化，可以放开锁校验
+        if ((first->done && firstValid < 0) || (second && second->done && secondValid < 0))
+        {
+            const bool checkFirst = first->done && firstValid < 0;
+            const bool checkSecond = second && second->done && secondValid < 0;
+            lock.unlock();
+            if (checkFirst)
+                firstValid = judge(first->response, primary.accept);
+            if (checkSecond)
+                secondValid = judge(second->response, secondAccept);
+            lock.lock();
+            continue;
+        }
+        // 主支路得到有效应答：中止仍在进行的对冲支路
+        if (firstValid == 1)
+        {
+            result.primary = first->response;
+            if (second && second->done)
+                result.hedge = second->response;
+            else if (second)
+            {
+                lock.unlock();
+                cancel(hedgeWorker, second);
+                result.hedge.aborted = true;
+            }
+            return result;
+        }
+        // 对冲支路得到有效应答：中止主支路
+        if (secondValid == 1)
+        {
+            result.hedge = second->response;
+            result.hedgeWon = true;
+            if (first->done)
+                result.primary = first->response;
+            else
+            {
+                lock.unlock();
+                cancel(primaryWorker, first);
+                result.primary.aborted = true;
+            }
+            return result;
+        }
+        // 主支路失败 (或应答无效) 且没有仍在进行的对冲支路
+        if (first->done && (!second || second->done))
+        {
+            result.primary = first->response;
+            if (second)
+                result.hedge = second->response;
+            return result;
+        }
+
+        const bool abort = shouldAbort && shouldAbort();
+        const auto now = std::chrono::steady_clock::now();
+        if (abort || now >= deadline)
+        {
+            const bool firstPending = !first->done;
+            const bool secondPending = second && !second->done;
+            lock.unlock();
+            if (firstPending)
+                cancel(primaryWorker, first);
+            if (secondPending)
+                cancel(hedgeWorker, second);
+            result.primary = Response();
+            result.primary.aborted = abort;
+            result.primary.timedOut = !abort;
+            return result;
+        }
+
+        if (!hedgeTried && now >= hedgeAt && !first->done)
+        {
+            hedgeTried = true;
+            lock.unlock();
+            const std::optional<Leg> leg = makeHedge();
+            if (leg)
+            {
+                second = launch(*leg, waiter, hedgeWorker);
+                secondAccept = leg->accept;
+            }
+            result.hedged = second != nullptr;
+            lock.lock();
+            continue;
+        }
+
+        auto wake = std::min(deadline, now + slice);
+        if (!hedgeTried)
+            wake = std::min(wake, hedgeAt);
+        waiter->cv.wait_until(lock, wake);
+    }
+}
+
+void UpstreamDispatcher::startCall(Worker *worker, const std::shared_ptr<Call> &call, QNetworkRequest request, const QByteArray &body)
+{
+    if (call->cancelled || call->epoch != m_epoch.load())
+    {
+        std::lock_guard<std::mutex> lock(call->waiter->mutex);
+        call->response.aborted = true;
+        call->response.error = QNetworkReply::OperationCanceledError;
+        call->done = true;
+        call->waiter->cv.notify_all();
+        return;
+    }
+
+    ensureNetwork(worker);
+
+    // 优先 HTTP/2：单条连接即可多路复用全部并发请求
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    // 退回 HTTP/1.1 时的每主机连接上限 (默认只有 6 条)
+    QHttp1Configuration h1;
+    h1.setNumberOfConnectionsPerHost(static_cast<qsizetype>(m_connectionsPerHost));
+    request.setHttp1Configuration(h1);
+
+    QNetworkReply *reply = worker->nam->post(request, body);
+    call->reply = reply;
+    worker->active.push_back(call);
+    QObject::connect(reply, &QNetworkReply::finished, worker->context, [this, worker, call, reply]()
+                     { finishCall(worker, call, reply); });
+    if (call->onChunk)
+    {
+        QObject::connect(reply, &QNetworkReply::readyRead, worker->context, [call, reply]()
+                         {
+            if (call->stoppedEarly)
+                return;
+            const QByteArray chunk = reply->readAll();
+            call->streamed += chunk;
+            if (!call->onChunk(chunk)) {
+                call->stoppedEarly = true;
+                reply->abort(); // 同步触发 finished，此后不得再访问 reply
+            } });
+    }
+}
+
+void UpstreamDispatcher::finishCall(Worker *worker, const std::shared_ptr<Call> &call, QNetworkReply *reply)
+{
+    Response r;
+    r.error = reply->error();
+    r.stoppedEarly = call->stoppedEarly;
+    r.aborted = (r.error == QNetworkReply::OperationCanceledError) && !r.stoppedEarly;
+    r.errorString = reply->errorString();
+    r.httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    r.retryAfter = reply->rawHeader("Retry-After");
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        HostStats &hs = m_hostStats[reply->url().host()];
+        hs.requests++;
+        if (reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool())
+            hs.http2++;
+    }
+    if (call->onChunk)
+    {
+        // 流式：把 readyRead 之后残留的字节也交给回调
+        const QByteArray rest = reply->readAll();
+        if (!rest.isEmpty() && !call->stoppedEarly)
+            call->onChunk(rest);
+        call->streamed += rest;
+        r.body = call->streamed;
+    }
+    else
+    {
+        r.body = reply->readAll();
+    }
+
+    call->reply = nullptr;
+    worker->active.erase(std::remove(worker->active.begin(), worker->active.end(), call), worker->active.end());
+    reply->deleteLater();
+
+    std::lock_guard<std::mutex> lock(call->waiter->mutex);
+    call->response = std::move(r);
+    call->done = true;
+    call->waiter->cv.notify_all();
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <QByteArray>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QString>
+#include <QUrl>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/**
+ * UpstreamDispatcher - 上游 HTTP 调度器
+ * 作用：由少量专用 I/O 线程持有网络栈 (每线程一个 QNetworkAccessManager)，
+ *       HTTP 工作线程只负责提交请求，然后在条件变量上带截止时间等待结果。
+ *       取代"每个工作线程各持有一个 QNetworkAccessManager 并轮询事件循环"的旧做法。
+ * 完成：应答在 I/O 线程的 finished 回调里写入共享状态并立即唤醒等待者，没有轮询延迟。
+ * 取消：等待方超时或被要求中止时投递 abort；abortAll 一次性中止全部在途请求 (停止服务)。
+ * 连接：各 I/O 线程的连接池在整个服务期间保持 keep-alive，优先 HTTP/2 多路复用，
+ *       启动时可预热 (提前完成 DNS + TCP + TLS 握手)，并按主机统计连接复用情况。
+ * 对冲：postHedged 在主请求超过给定延迟仍未完成时补发一份副本，先得到有效应答者胜出，另一方被中止。
+ */
+class UpstreamDispatcher {
+public:
+    struct Response {
+        bool timedOut = false;
+        bool aborted = false;
+        // onChunk 要求提前中止 (流式应答判定失控)
+        bool stoppedEarly = false;
+        QNetworkReply::NetworkError error = QNetworkReply::NoError;
+        QString errorString;
+        int httpStatus = 0;
+        QByteArray retryAfter;
+        QByteArray body;
+    };
+
+    // 按主机统计：请求数、新建 TLS 握手数 (其余请求均复用了已有连接)、走 HTTP/2 的请求数
+    struct HostStats {
+        quint64 requests = 0;
+        quint64 handshakes = 0;
+        quint64 http2 = 0;
+        quint64 prewarms = 0;
+    };
+
+    UpstreamDispatcher();
+    ~UpstreamDispatcher();
+
+    UpstreamDispatcher(const UpstreamDispatcher&) = delete;
+    UpstreamDispatcher& operator=(const UpstreamDispatcher&) = delete;
+
+    // 启动 I/O 线程；connectionsPerHost 为每个线程对同一主机的 HTTP/1.1 并发连接上限
+    void start(int ioThreads, int connectionsPerHost);
+    // 中止在途请求并回收 I/O 线程
+    void stop();
+
+    // 流式应答的增量回调：在 I/O 线程中对每批新到达的字节调用，返回 false 即中止请求
+    using ChunkHandler = std::function<bool(const QByteArray&)>;
+
+    // 对冲请求的一条支路
+    struct Leg {
+        QNetworkRequest request;
+        QByteArray body;
+        ChunkHandler onChunk;
+        // 校验传输成功的应答内容 (在等待线程中调用，不持锁)；返回 false 时该支路不算胜出，另一支路继续
+        std::function<bool(const Response&)> accept;
+    };
+
+    struct HedgedResponse {
+        Response primary;   // 主支路 (对冲胜出时为 aborted)
+        Response hedge;     // 对冲支路 (未发出时为默认值)
+        bool hedged = false;
+        bool hedgeWon = false;
+        const Response& winner() const { return hedgeWon ? hedge : primary; }
+    };
+
+    // 提交主支路并阻塞等待：完成、超过 timeoutMs 或 shouldAbort() 返回 true 时返回。
+    // hedgeDelayMs 后 (>= 0 时) 仍未完成则调用 makeHedge 取得副本并发出。
+    // 任一支路得到有效应答 (传输成功且通过其 accept 校验) 即返回并中止另一支路；两路都失败时返回主支路的结果
+    HedgedResponse postHedged(const Leg& primary, qint64 hedgeDelayMs, const std::function<std::optional<Leg>()>& makeHedge,
+                              int timeoutMs, const std::function<bool()>& shouldAbort);
+
+    // 中止全部在途请求 (包括尚在队列中未发出的)
+    void abortAll();
+
+    // 预热：每个 I/O 线程提前建立到该主机的连接 (HTTPS 时协商 HTTP/2)
+    void prewarm(const QUrl& url);
+
+    std::map<QString, HostStats> hostStats() const;
+
+private:
+    struct Call;
+    struct Worker;
+    struct Waiter;
+
+    // 选定 I/O 线程并投递请求；没有可用线程时返回空
+    std::shared_ptr<Call> launch(const Leg& leg, const std::shared_ptr<Waiter>& waiter, Worker*& worker);
+    static void cancel(Worker* worker, const std::shared_ptr<Call>& call);
+
+    // 以下函数只在对应 Worker 的 I/O 线程中执行
+    void ensureNetwork(Worker* worker);
+    void startCall(Worker* worker, const std::shared_ptr<Call>& call, QNetworkRequest request, const QByteArray& body);
+    void finishCall(Worker* worker, const std::shared_ptr<Call>& call, QNetworkReply* reply);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::mutex m_workersMutex;
+    std::atomic<unsigned> m_nextWorker{0};
+    // 每次 abortAll 递增；提交时记录的代数不一致说明该请求已被整体中止
+    std::atomic<quint64> m_epoch{0};
+    int m_connectionsPerHost = 6;
+
+    std::map<QString, HostStats> m_hostStats;
+    mutable std::mutex m_statsMutex;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+/**
+ * UpstreamHedging - 对冲请求与多端点故障转移的策略
+ * 作用：记录主端点最近的应答延迟，请求超过其 p90 仍未完成时，
+ *       向备用端点 (或同端点的备用模型) 补发一份副本，先返回有效译文者胜出，另一方被中止；
+ *       主端点遇到硬错误时，下一次重试直接改走备用端点。
+ * 备用端点：按顺序轮询；每个端点自带 Key 列表 (多个 Key 同样轮询) 与模型名。
+ * 延迟样本不足 MIN_SAMPLES 时不对冲 (此时还没有可信的 p90)，故障转移不受影响。
+ */
+class UpstreamHedging {
+public:
+    struct Endpoint {
+        QString url;
+        QString model;
+        QStringList keys;
+    };
+
+    struct Target {
+        QString url;
+        QString model;
+        QString key;
+        bool valid() const { return !url.isEmpty(); }
+    };
+
+    struct Stats {
+        int endpoints = 0;
+        qint64 p90Ms = 0;
+        quint64 hedged = 0;
+        quint64 hedgeWins = 0;
+        quint64 failovers = 0;
+    };
+
+    void configure(const std::vector<Endpoint>& endpoints, int minDelayMs) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_endpoints.clear();
+        for (const Endpoint& ep : endpoints) {
+            if (!ep.url.isEmpty() && !ep.keys.isEmpty() && !ep.model.isEmpty())
+                m_endpoints.push_back({ep, 0});
+        }
+        m_minDelayMs = std::max(0, minDelayMs);
+    }
+
+    bool enabled() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return !m_endpoints.empty();
+    }
+
+    // 轮询取下一个备用端点；failover 为 true 时计入故障转移次数
+    Target next(bool failover) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_endpoints.empty())
+            return Target();
+        Slot& slot = m_endpoints[m_nextEndpoint++ % m_endpoints.size()];
+        Target t;
+        t.url = slot.endpoint.url;
+        t.model = slot.endpoint.model;
+        t.key = slot.endpoint.keys[slot.nextKey++ % slot.endpoint.keys.size()].trimmed();
+        if (failover)
+            m_stats.failovers++;
+        return t;
+    }
+
+    // 主端点的一次应答耗时 (被对冲中止的请求以中止时刻计，保证 p90 不被低估)
+    void recordPrimaryLatency(qint64 ms) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_samples.size() < WINDOW)
+            m_samples.push_back(ms);
+        else
+            m_samples[m_nextSample] = ms;
+        m_nextSample = (m_nextSample + 1) % WINDOW;
+        m_p90Ms = -1; // 惰性重算
+    }
+
+    // 对冲延迟：主端点 p90 (不低于 minDelay)；样本不足或无备用端点时返回 -1 表示不对冲
+    qint64 hedgeDelayMs() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_endpoints.empty() || m_samples.size() < MIN_SAMPLES)
+            return -1;
+        return std::max<qint64>(m_minDelayMs, p90());
+    }
+
+    void recordHedge(bool won) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.hedged++;
+        if (won)
+            m_stats.hedgeWins++;
+    }
+
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stats st = m_stats;
+        st.endpoints = static_cast<int>(m_endpoints.size());
+        st.p90Ms = m_samples.size() < MIN_SAMPLES ? 0 : p90();
+        return st;
+    }
+
+private:
+    struct Slot {
+        Endpoint endpoint;
+        size_t nextKey = 0;
+    };
+
+    qint64 p90() {
+        if (m_p90Ms < 0) {
+            std::vector<qint64> sorted = m_samples;
+            const size_t k = (sorted.size() * 9) / 10;
+            std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(k), sorted.end());
+            m_p90Ms = sorted[k];
+        }
+        return m_p90Ms;
+    }
+
+    static constexpr size_t WINDOW = 256;
+    static constexpr size_t MIN_SAMPLES = 20;
+
+    std::vector<Slot> m_endpoints;
+    size_t m_nextEndpoint = 0;
+    int m_minDelayMs = 800;
+    std::vector<qint64> m_samples;
+    size_t m_nextSample = 0;
+    qint64 m_p90Ms = -1;
+    Stats m_stats;
+    mutable std::mutex m_mutex;
+};
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * WTinyLfuIndex - 按字节预算限制内存的 W-TinyLFU 键值索引
+ * 结构：窗口 LRU (约 1%) + 主区分段 LRU (试用区 20% / 保护区 80%)，
+ *       由 Count-Min Sketch 估算访问频率决定窗口淘汰者能否挤进主区。
+ * 效果：一次性涌入的大量新文本 (如文本转储、快速跳过剧情) 只会在窗口里打转，
+ *       不会把高频的 UI 词汇挤出缓存。
+ * 线程：本类不加锁，由调用方 (TranslationCache) 统一加锁。
+ */
+class WTinyLfuIndex {
+public:
+    explicit WTinyLfuIndex(size_t budgetBytes = 64ull * 1024 * 1024) { setBudget(budgetBytes); }
+
+    WTinyLfuIndex(const WTinyLfuIndex&) = delete;
+    WTinyLfuIndex& operator=(const WTinyLfuIndex&) = delete;
+    // 移动后链表节点地址不变，映射表中的 string_view 与迭代器仍然有效
+    WTinyLfuIndex(WTinyLfuIndex&&) = default;
+    WTinyLfuIndex& operator=(WTinyLfuIndex&&) = default;
+
+    void setBudget(size_t budgetBytes) {
+        m_budget = budgetBytes < 64 * 1024 ? 64 * 1024 : budgetBytes;
+        m_windowBudget = m_budget / 100 + 1;
+        m_protectedBudget = (m_budget - m_windowBudget) * 8 / 10;
+        resizeSketch();
+        evictIfNeeded();
+    }
+
+    void clear() {
+        m_map.clear();
+        m_window.clear();
+        m_probation.clear();
+        m_protected.clear();
+        m_windowBytes = m_probationBytes = m_protectedBytes = 0;
+        std::fill(m_sketch.begin(), m_sketch.end(), 0);
+        m_sketchAdditions = 0;
+    }
+
+    // 查询并记录一次访问；返回的指针在下一次修改前有效
+    const std::string* find(const std::string& key) {
+        const uint64_t h = hashKey(key);
+        recordAccess(h);
+        auto it = m_map.find(std::string_view(key));
+        if (it == m_map.end())
+            return nullptr;
+        touch(it->second);
+        return &it->second->value;
+    }
+
+    // 仅查询，不影响频率与顺序
+    const std::string* peek(const std::string& key) const {
+        auto it = m_map.find(std::string_view(key));
+        return it == m_map.end() ? nullptr : &it->second->value;
+    }
+
+    bool contains(const std::string& key) const { return peek(key) != nullptr; }
+
+    // 插入或更新；新条目进入窗口区，是否最终留下由 TinyLFU 准入决定
+    void put(const std::string& key, const std::string& value) {
+        auto it = m_map.find(std::string_view(key));
+        if (it != m_map.end()) {
+            NodeIt node = it->second;
+            adjustBytes(node->segment, static_cast<int64_t>(value.size()) - static_cast<int64_t>(node->value.size()));
+            node->value = value;
+            touch(node);
+            evictIfNeeded();
+            return;
+        }
+
+        recordAccess(hashKey(key));
+        m_window.push_front(Node{key, value, Segment::Window});
+        NodeIt node = m_window.begin();
+        m_map.emplace(std::string_view(node->key), node);
+        m_windowBytes += entryBytes(*node);
+        evictIfNeeded();
+    }
+
+    size_t size() const { return m_map.size(); }
+    size_t bytes() const { return m_windowBytes + m_probationBytes + m_protectedBytes; }
+    size_t budget() const { return m_budget; }
+    uint64_t evictions() const { return m_evictions; }
+
+    // 按 冷 -> 热 顺序遍历 (用于压缩重写磁盘文件，热数据写在最后以便加载时最后进入)
+    void forEach(const std::function<void(const std::string&, const std::string&)>& fn) const {
+        for (auto it = m_probation.rbegin(); it != m_probation.rend(); ++it) fn(it->key, it->value);
+        for (auto it = m_window.rbegin(); it != m_window.rend(); ++it) fn(it->key, it->value);
+        for (auto it = m_protected.rbegin(); it != m_protected.rend(); ++it) fn(it->key, it->value);
+    }
+
+private:
+    enum class Segment { Window, Probation, Protected };
+    struct Node {
+        std::string key;
+        std::string value;
+        Segment segment;
+    };
+    using NodeList = std::list<Node>;
+    using NodeIt = NodeList::iterator;
+
+    // 每条目的估算开销：键值本身 + 链表节点 + 哈希表节点
+    static size_t entryBytes(const Node& n) { return n.key.size() + n.value.size() + 96; }
+
+    static uint64_t hashKey(const std::string& key) {
+        uint64_t h = std::hash<std::string>{}(key);
+        // 再混合一次，防止标准库哈希低位质量不足
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    NodeList& listOf(Segment s) {
+        return s == Segment::Window ? m_window : (s == Segment::Probation ? m_probation : m_protected);
+    }
+
+    void adjustBytes(Segment s, int64_t delta) {
+        size_t& b = s == Segment::Window ? m_windowBytes : (s == Segment::Probation ? m_probationBytes : m_protectedBytes);
+        b = static_cast<size_t>(static_cast<int64_t>(b) + delta);
+    }
+
+    void moveTo(NodeIt node, Segment target) {
+        const int64_t sz = static_cast<int64_t>(entryBytes(*node));
+        adjustBytes(node->segment, -sz);
+        listOf(target).splice(listOf(target).begin(), listOf(node->segment), node);
+        node->segment = target;
+        adjustBytes(target, sz);
+    }
+
+    // 命中：窗口/保护区移到队首，试用区晋升保护区
+    void touch(NodeIt node) {
+        if (node->segment == Segment::Probation) {
+            moveTo(node, Segment::Protected);
+            // 保护区超额时把最旧的降级回试用区
+            while (m_protectedBytes > m_protectedBudget && m_protected.size() > 1)
+                moveTo(std::prev(m_protected.end()), Segment::Probation);
+        } else {
+            NodeList& list = listOf(node->segment);
+            list.splice(list.begin(), list, node);
+        }
+    }
+
+    void evictIfNeeded() {
+        // 窗口溢出的条目成为候选者，与主区的淘汰者比较频率
+        while (m_windowBytes > m_windowBudget && !m_window.empty()) {
+            NodeIt candidate = std::prev(m_window.end());
+            moveTo(candidate, Segment::Probation);
+            // 新晋升者放在试用区队尾参与比较
+            m_probation.splice(m_probation.end(), m_probation, candidate);
+            if (bytes() <= m_budget)
+                continue;
+            NodeIt victim = m_probation.begin() == candidate ? m_probation.end() : std::prev(candidate);
+            if (victim == m_probation.end() || victim == candidate) {
+                evict(candidate);
+                continue;
+            }
+            if (estimate(hashKey(candidate->key)) > estimate(hashKey(victim->key))) {
+                m_probation.splice(m_probation.begin(), m_probation, candidate);
+                evict(victim);
+            } else {
+                evict(candidate);
+            }
+        }
+        // 主区整体超额 (例如预算被调小)：从试用区、再从保护区尾部淘汰
+        while (bytes() > m_budget) {
+            if (!m_probation.empty())
+                evict(std::prev(m_probation.end()));
+            else if (!m_protected.empty())
+                evict(std::prev(m_protected.end()));
+            else if (!m_window.empty())
+                evict(std::prev(m_window.end()));
+            else
+                break;
+        }
+    }
+
+    void evict(NodeIt node) {
+        adjustBytes(node->segment, -static_cast<int64_t>(entryBytes(*node)));
+        m_map.erase(std::string_view(node->key));
+        listOf(node->segment).erase(node);
+        m_evictions++;
+    }
+
+    // --- Count-Min Sketch (4 行，8 位饱和计数，定期减半实现老化) ---
+    void resizeSketch() {
+        // 以平均 256 字节/条估算容量，宽度取 2 的幂
+        size_t expected = m_budget / 256;
+        size_t width = 1024;
+        while (width < expected && width < (1u << 22))
+            width <<= 1;
+        m_sketchWidth = width;
+        m_sketch.assign(width * 4, 0);
+        m_sketchSampleSize = width * 10;
+        m_sketchAdditions = 0;
+    }
+
+    size_t sketchIndex(uint64_t h, int row) const {
+        const uint64_t mixed = h + static_cast<uint64_t>(row) * (0x9E3779B97F4A7C15ULL ^ (h >> 29));
+        return row * m_sketchWidth + static_cast<size_t>((mixed ^ (mixed >> 31)) & (m_sketchWidth - 1));
+    }
+
+    void recordAccess(uint64_t h) {
+        for (int row = 0; row < 4; ++row) {
+            uint8_t& c = m_sketch[sketchIndex(h, row)];
+            if (c < 255)
+                ++c;
+        }
+        if (++m_sketchAdditions >= m_sketchSampleSize) {
+            for (uint8_t& c : m_sketch)
+                c >>= 1;
+            m_sketchAdditions /= 2;
+        }
+    }
+
+    uint8_t estimate(uint64_t h) const {
+        uint8_t m = 255;
+        for (int row = 0; row < 4; ++row) {
+            const uint8_t c = m_sketch[sketchIndex(h, row)];
+            if (c < m)
+                m = c;
+        }
+        return m;
+    }
+
+    std::unordered_map<std::string_view, NodeIt> m_map;
+    NodeList m_window;
+    NodeList m_probation;
+    NodeList m_protected;
+
+    size_t m_budget = 0;
+    size_t m_windowBudget = 0;
+    size_t m_protectedBudget = 0;
+    size_t m_windowBytes = 0;
+    size_t m_probationBytes = 0;
+    size_t m_protectedBytes = 0;
+    uint64_t m_evictions = 0;
+
+    std::vector<uint8_t> m_sketch;
+    size_t m_sketchWidth = 0;
+    size_t m_sketchSampleSize = 0;
+    size_t m_sketchAdditions = 0;
+};
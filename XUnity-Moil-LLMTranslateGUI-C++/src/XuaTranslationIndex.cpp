@@ -0,0 +1,239 @@
+#include "XuaTranslationIndex.h"
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// 小于该大小的文件不值得切块并行
+const qint64 PARALLEL_MIN_BYTES = 256 * 1024;
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+}
+
+void XuaTranslationIndex::clear()
+{
+    for (Shard &shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.map.clear();
+    }
+}
+
+size_t XuaTranslationIndex::size() const
+{
+    size_t total = 0;
+    for (const Shard &shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.map.size();
+    }
+    return total;
+}
+
+bool XuaTranslationIndex::lookup(const QString &source, QString &translation) const
+{
+    const std::string key = source.toStdString();
+    const Shard &shard = m_shards[std::hash<std::string>{}(key) % SHARD_COUNT];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end())
+        return false;
+    translation = QString::fromStdString(it->second);
+    return true;
+}
+
+QStringList XuaTranslationIndex::collectFiles(const QString &dirPath)
+{
+    QStringList autoFiles;
+    QStringList manualFiles;
+    QDirIterator it(dirPath, QStringList() << "*.txt", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        const QString path = it.next();
+        const QString name = QFileInfo(path).fileName();
+        // 术语/正则规则文件不是译文
+        if (name.startsWith("_Substitutions", Qt::CaseInsensitive) ||
+            name.startsWith("_Preprocessors", Qt::CaseInsensitive) ||
+            name.startsWith("_Postprocessors", Qt::CaseInsensitive))
+            continue;
+        if (name.startsWith("_AutoGeneratedTranslations", Qt::CaseInsensitive))
+            autoFiles << path;
+        else
+            manualFiles << path;
+    }
+    autoFiles.sort();
+    manualFiles.sort();
+    return autoFiles + manualFiles;
+}
+
+size_t XuaTranslationIndex::loadFile(const QString &path, const std::atomic<bool> &cancel)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+    const qint64 fileSize = file.size();
+    if (fileSize <= 0)
+        return 0;
+
+    QByteArray fallback;
+    uchar *mapped = file.map(0, fileSize);
+    const char *data = reinterpret_cast<const char *>(mapped);
+    if (!mapped)
+    {
+        // 映射失败时退化为一次性读取
+        fallback = file.readAll();
+        if (fallback.size() != fileSize)
+            return 0;
+        data = fallback.constData();
+    }
+    const char *end = data + fileSize;
+    if (fileSize >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+        data += 3; // UTF-8 BOM
+
+    // 按换行边界切块，交给多个线程并行解析
+    size_t workers = 1;
+    if (fileSize >= PARALLEL_MIN_BYTES)
+        workers = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 8);
+
+    std::vector<const char *> bounds;
+    bounds.push_back(data);
+    const qint64 step = (end - data) / static_cast<qint64>(workers);
+    for (size_t w = 1; w < workers; ++w)
+    {
+        const char *cut = data + step * static_cast<qint64>(w);
+        cut = std::find(std::max(cut, bounds.back()), end, '\n');
+        bounds.push_back(cut == end ? end : cut + 1);
+    }
+    bounds.push_back(end);
+
+    // 各块解析到自己的列表，全部完成后按块顺序并入：文件中靠后的行覆盖靠前的
+    std::vector<Entries> chunks(workers);
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < workers; ++w)
+        threads.emplace_back([&bounds, &chunks, &cancel, w]()
+                             { parseChunk(bounds[w], bounds[w + 1], cancel, chunks[w]); });
+    parseChunk(bounds[0], bounds[1], cancel, chunks[0]);
+    for (std::thread &t : threads)
+        t.join();
+
+    if (mapped)
+        file.unmap(mapped);
+
+    size_t total = 0;
+    for (Entries &entries : chunks)
+    {
+        if (cancel.load(std::memory_order_relaxed))
+            break;
+        for (auto &entry : entries)
+            insert(std::move(entry.first), std::move(entry.second));
+        total += entries.size();
+    }
+    return total;
+}
+
+void XuaTranslationIndex::parseChunk(const char *begin, const char *end, const std::atomic<bool> &cancel, Entries &out)
+{
+    size_t lines = 0;
+    const char *lineStart = begin;
+    while (lineStart < end)
+    {
+        if ((lines++ & 0x3FF) == 0 && cancel.load(std::memory_order_relaxed))
+            break;
+
+        const char *lineEnd = std::find(lineStart, end, '\n');
+        const char *b = lineStart;
+        const char *e = lineEnd;
+        lineStart = (lineEnd == end) ? end : lineEnd + 1;
+
+        while (b < e && isSpace(*b))
+            ++b;
+        while (e > b && isSpace(*(e - 1)))
+            --e;
+        if (b == e)
+            continue;
+
+        // 跳过注释与正则规则 (r:"..." / sr:"...")
+        if ((e - b >= 2 && b[0] == '/' && b[1] == '/') ||
+            (e - b >= 3 && std::memcmp(b, "r:\"", 3) == 0) ||
+            (e - b >= 4 && std::memcmp(b, "sr:\"", 4) == 0))
+            continue;
+
+        // 第一个未被转义的 '=' 是分隔符
+        const char *sep = nullptr;
+        for (const char *p = b; p < e; ++p)
+        {
+            if (*p == '\\')
+            {
+                ++p;
+                continue;
+            }
+            if (*p == '=')
+            {
+                sep = p;
+                break;
+            }
+        }
+        if (!sep || sep == b || sep + 1 >= e)
+            continue;
+
+        std::string key = unescape(b, sep);
+        std::string value = unescape(sep + 1, e);
+        if (key.empty() || value.empty() || key == value)
+            continue;
+
+        out.emplace_back(std::move(key), std::move(value));
+    }
+}
+
+void XuaTranslationIndex::insert(std::string &&key, std::string &&value)
+{
+    Shard &shard = m_shards[std::hash<std::string>{}(key) % SHARD_COUNT];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.map[std::move(key)] = std::move(value);
+}
+
+std::string XuaTranslationIndex::unescape(const char *begin, const char *end)
+{
+    std::string out;
+    out.reserve(static_cast<size_t>(end - begin));
+    for (const char *p = begin; p < end; ++p)
+    {
+        if (*p != '\\' || p + 1 >= end)
+        {
+            out.push_back(*p);
+            continue;
+        }
+        const char next = *(p + 1);
+        switch (next)
+        {
+        case 'n':
+            out.push_back('\n');
+            break;
+        case 'r':
+            out.push_back('\r');
+            break;
+        case 't':
+            out.push_back('\t');
+            break;
+        case '=':
+        case '\\':
+            out.push_back(next);
+            break;
+        default:
+            // 未知转义保持原样
+            out.push_back('\\');
+            out.push_back(next);
+            break;
+        }
+        ++p;
+    }
+    return out;
+}
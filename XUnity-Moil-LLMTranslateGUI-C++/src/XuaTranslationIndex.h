@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * XuaTranslationIndex - XUnity 现有译文文件的精确匹配索引 (热启动)
+ * 作用：启动服务时在后台读取 _AutoGeneratedTranslations.txt 及同目录的其他 *.txt，
+ *       之前会话已经翻译过的文本从此不再进入 LLM。
+ * 特性：文件内存映射后按行切块并行解析，再按块的顺序依次并入索引：同一原文出现多次时
+ *       与 XUnity 一致以靠后的一行为准，结果与线程调度无关；分片加锁，加载期间即可查询 (未加载到的条目视为未命中)。
+ */
+class XuaTranslationIndex {
+public:
+    XuaTranslationIndex() = default;
+
+    XuaTranslationIndex(const XuaTranslationIndex&) = delete;
+    XuaTranslationIndex& operator=(const XuaTranslationIndex&) = delete;
+
+    void clear();
+    size_t size() const;
+
+    // 精确匹配查询 (原文需与 XUnity 记录完全一致，换行使用真实 \n)
+    bool lookup(const QString& source, QString& translation) const;
+
+    // 收集目录 (递归) 下可用的译文文件：_AutoGeneratedTranslations.txt 排最前，手工译文后加载以覆盖之
+    static QStringList collectFiles(const QString& dirPath);
+
+    // 加载单个文件，返回新增条目数；cancel 置位后尽快返回
+    size_t loadFile(const QString& path, const std::atomic<bool>& cancel);
+
+    // 还原 XUnity 转义 (\n、\r、\t、\=、\\)
+    static std::string unescape(const char* begin, const char* end);
+
+private:
+    using Entries = std::vector<std::pair<std::string, std::string>>;
+    // 解析 [begin, end) 区间内的全部行，按出现顺序写入 out
+    static void parseChunk(const char* begin, const char* end, const std::atomic<bool>& cancel, Entries& out);
+    void insert(std::string&& key, std::string&& value);
+
+    static const int SHARD_COUNT = 16;
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::string> map;
+    };
+    Shard m_shards[SHARD_COUNT];
+};
@@ -16,6 +16,8 @@
 #include "MainWindow.h"    // 经典模式窗口头文件
 #include "ModernWindow.h"  // 流光模式窗口头文件
 #include "ConfigManager.h" // 配置管理器头文件
+#include "BulkTranslator.h" // 命令行离线预翻译
+#include <cstring>
 
 // ==========================================
 // � 扑克牌翻面覆盖层：专用于 经典 -> 流光 的物理撕裂效果
@@ -85,6 +87,13 @@ protected:
 
 int main(int argc, char *argv[])
 {
+    // 📚 命令行离线预翻译模式 (--pretranslate <文本转储>)：不创建任何窗口
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--pretranslate") == 0 || std::strncmp(argv[i], "--pretranslate=", 15) == 0)
+            return BulkTranslator::runCommandLine(argc, argv);
+    }
+
     QApplication app(argc, argv);
     app.setStyle("Fusion");
 
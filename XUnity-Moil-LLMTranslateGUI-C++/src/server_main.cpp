@@ -0,0 +1,95 @@
+// --- server_main.cpp ---
+// 无界面服务入口 (XUnityTranslatorServer)：只链接 QtCore / QtNetwork，由 config.ini 与命令行驱动。
+// 适合后台部署与多开：每个实例用各自的 --config (端口、缓存路径不同) 即可并行运行。
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTimer>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include "BulkTranslator.h"    // --pretranslate 离线预翻译
+#include "ConfigManager.h"     // 配置管理器头文件
+#include "LogManager.h"
+#include "TranslationServer.h"
+
+namespace
+{
+// 信号处理函数里只置位，由事件循环中的定时器轮询后退出
+std::atomic<bool> g_quitRequested{false};
+
+void onTerminate(int)
+{
+    g_quitRequested = true;
+}
+
+void printLine(FILE *stream, const QString &text)
+{
+    const QByteArray bytes = text.toUtf8();
+    std::fwrite(bytes.constData(), 1, static_cast<size_t>(bytes.size()), stream);
+    std::fputc('\n', stream);
+    std::fflush(stream);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    // 📚 离线预翻译与图形界面版共用同一套命令行
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--pretranslate") == 0 || std::strncmp(argv[i], "--pretranslate=", 15) == 0)
+            return BulkTranslator::runCommandLine(argc, argv);
+    }
+
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("XUnity LLM Translator - headless translation server");
+    parser.addHelpOption();
+    QCommandLineOption configOption("config", "Configuration file.", "file", "config.ini");
+    QCommandLineOption portOption(QStringList() << "p" << "port", "Listen port (overrides the configuration file).", "port");
+    parser.addOption(configOption);
+    parser.addOption(portOption);
+    parser.process(app);
+
+    AppConfig cfg = ConfigManager::loadConfig(parser.value(configOption));
+    if (parser.isSet(portOption))
+    {
+        bool ok = false;
+        const int port = parser.value(portOption).toInt(&ok);
+        if (!ok || port <= 0 || port > 65535)
+        {
+            printLine(stderr, QString("Invalid port: %1").arg(parser.value(portOption)));
+            return 1;
+        }
+        cfg.port = port;
+    }
+
+    TranslationServer server;
+    QObject::connect(&server, &TranslationServer::logMessage, [](const QString &msg)
+                     { printLine(stdout, LogManager::toPlainText(msg)); });
+    QObject::connect(&server, &TranslationServer::serverStopped, &app, &QCoreApplication::quit, Qt::QueuedConnection);
+    // 端口被占用等：照常收尾后以非零状态退出，便于服务管理器发现
+    bool listenFailed = false;
+    QObject::connect(&server, &TranslationServer::listenFailed, &app, [&server, &listenFailed](int)
+                     {
+        listenFailed = true;
+        server.stopServer(); }, Qt::QueuedConnection);
+    server.updateConfig(cfg);
+    server.startServer();
+
+    // Ctrl+C / 服务管理器停止：走与界面"停止服务"相同的收尾 (排空进行中的请求、还原游戏配置、落盘译文记忆)；
+    // 排空期间再按一次 Ctrl+C 立即中止
+    std::signal(SIGINT, onTerminate);
+    std::signal(SIGTERM, onTerminate);
+    QTimer quitPoll;
+    QObject::connect(&quitPoll, &QTimer::timeout, [&server]()
+                     {
+        if (g_quitRequested.exchange(false))
+            server.stopServer(); });
+    quitPoll.start(200);
+
+    const int code = app.exec();
+    return listenFailed ? 1 : code;
+}